@@ -19,9 +19,10 @@ func (p *Program) TokenLiteral() string {
 
 // Decorator represents @decorator annotations
 type Decorator struct {
-	Name   string
-	Args   []string
-	KVArgs map[string]string // For key: value arguments
+	Name     string
+	Args     []string
+	KVArgs   map[string]string   // For key: value arguments
+	ListArgs map[string][]string // For key: [a, b] arguments
 }
 
 func (d *Decorator) TokenLiteral() string { return "@" + d.Name }
@@ -87,6 +88,14 @@ type DataListDecl struct {
 
 func (d *DataListDecl) TokenLiteral() string { return "DataList" }
 
+// StatDecl represents a Stat UI component: one aggregate value, such as
+// value: Todo.count(where completed)
+type StatDecl struct {
+	Properties map[string]interface{}
+}
+
+func (s *StatDecl) TokenLiteral() string { return "Stat" }
+
 // FormDecl represents a Form UI component
 type FormDecl struct {
 	Properties map[string]string
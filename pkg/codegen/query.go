@@ -0,0 +1,530 @@
+package codegen
+
+import (
+	"fmt"
+	"html"
+	"strconv"
+	"strings"
+
+	"github.com/gunesh/zelang/pkg/ast"
+	"github.com/gunesh/zelang/pkg/lexer"
+)
+
+// QueryParam is a literal from a query expression, bound to its statement
+// as a parameter instead of being pasted into the SQL
+type QueryParam struct {
+	CType string // int64_t, double, char* or int
+	Value string // C literal
+}
+
+// StatData describes a Stat component: an aggregate query with its own
+// prepared statement, rendered as a card on the page
+type StatData struct {
+	Struct string // Struct queried
+	Index  int    // 1-based, per struct: Struct_stat_<Index>
+	Label  string // HTML-escaped, as a C string literal
+	Source string
+	SQL    string
+	Params []QueryParam
+}
+
+// queryParser reads the small query language used by page components,
+// e.g. Todo.count(where completed && priority > 2). It works on the
+// tokens of the source string and checks every name against the struct.
+type queryParser struct {
+	tokens []lexer.Token
+	pos    int
+	s      *ast.StructDecl
+	params []QueryParam
+}
+
+func newQueryParser(src string) *queryParser {
+	l := lexer.New(src)
+	q := &queryParser{}
+	for {
+		tok := l.NextToken()
+		q.tokens = append(q.tokens, tok)
+		if tok.Type == lexer.EOF {
+			break
+		}
+	}
+	return q
+}
+
+func (q *queryParser) cur() lexer.Token { return q.tokens[q.pos] }
+
+func (q *queryParser) next() lexer.Token {
+	tok := q.tokens[q.pos]
+	if tok.Type != lexer.EOF {
+		q.pos++
+	}
+	return tok
+}
+
+func (q *queryParser) expect(t lexer.TokenType) (lexer.Token, error) {
+	tok := q.next()
+	if tok.Type != t {
+		return tok, fmt.Errorf("expected %s, got %q", t, tok.Literal)
+	}
+	return tok, nil
+}
+
+// structRef reads "Model." and resolves the struct it names
+func (q *queryParser) structRef(structs []*ast.StructDecl) error {
+	name, err := q.expect(lexer.IDENT)
+	if err != nil {
+		return err
+	}
+	for _, s := range structs {
+		if s.Name == name.Literal {
+			q.s = s
+		}
+	}
+	if q.s == nil {
+		return fmt.Errorf("unknown struct %s", name.Literal)
+	}
+	_, err = q.expect(lexer.DOT)
+	return err
+}
+
+// field reads a field name of the queried struct
+func (q *queryParser) field() (*ast.FieldDecl, error) {
+	tok, err := q.expect(lexer.IDENT)
+	if err != nil {
+		return nil, err
+	}
+	for _, f := range q.s.Fields {
+		if f.Name == tok.Literal && !f.IsArray {
+			return f, nil
+		}
+	}
+	return nil, fmt.Errorf("struct %s has no field %s", q.s.Name, tok.Literal)
+}
+
+// where compiles a condition into SQL, appending its literals to q.params:
+//
+//	expr  := and ("||" and)*
+//	and   := unary ("&&" unary)*
+//	unary := "!" unary | "(" expr ")" | field [op literal]
+//
+// A bare field must be a bool and means field is true.
+func (q *queryParser) where() (string, error) {
+	left, err := q.and()
+	if err != nil {
+		return "", err
+	}
+	for q.cur().Type == lexer.OR {
+		q.next()
+		right, err := q.and()
+		if err != nil {
+			return "", err
+		}
+		left = left + " OR " + right
+	}
+	return left, nil
+}
+
+func (q *queryParser) and() (string, error) {
+	left, err := q.unary()
+	if err != nil {
+		return "", err
+	}
+	for q.cur().Type == lexer.AND {
+		q.next()
+		right, err := q.unary()
+		if err != nil {
+			return "", err
+		}
+		left = left + " AND " + right
+	}
+	return left, nil
+}
+
+func (q *queryParser) unary() (string, error) {
+	switch q.cur().Type {
+	case lexer.NOT:
+		q.next()
+		inner, err := q.unary()
+		if err != nil {
+			return "", err
+		}
+		return "NOT " + inner, nil
+	case lexer.LPAREN:
+		q.next()
+		inner, err := q.where()
+		if err != nil {
+			return "", err
+		}
+		if _, err := q.expect(lexer.RPAREN); err != nil {
+			return "", err
+		}
+		return "(" + inner + ")", nil
+	}
+	return q.comparison()
+}
+
+var sqlOperators = map[lexer.TokenType]string{
+	lexer.EQ:     "=",
+	lexer.NOT_EQ: "!=",
+	lexer.LT:     "<",
+	lexer.LTE:    "<=",
+	lexer.GT:     ">",
+	lexer.GTE:    ">=",
+}
+
+func (q *queryParser) comparison() (string, error) {
+	f, err := q.field()
+	if err != nil {
+		return "", err
+	}
+
+	op, ok := sqlOperators[q.cur().Type]
+	if !ok {
+		if f.Type != "bool" {
+			return "", fmt.Errorf("%s is not a bool; compare it with a value", f.Name)
+		}
+		return f.Name + " != 0", nil
+	}
+	q.next()
+
+	if f.Type == "bool" && op != "=" && op != "!=" {
+		return "", fmt.Errorf("%s is a bool; only == and != apply", f.Name)
+	}
+	param, err := q.literal(f)
+	if err != nil {
+		return "", err
+	}
+	q.params = append(q.params, param)
+	return f.Name + " " + op + " ?", nil
+}
+
+// literal reads a value to compare field f with and checks its type
+func (q *queryParser) literal(f *ast.FieldDecl) (QueryParam, error) {
+	sign := ""
+	if q.cur().Type == lexer.MINUS {
+		q.next()
+		sign = "-"
+	}
+	tok := q.next()
+
+	switch f.Type {
+	case "bool":
+		if sign == "" && tok.Type == lexer.TRUE {
+			return QueryParam{CType: "int", Value: "1"}, nil
+		}
+		if sign == "" && tok.Type == lexer.FALSE {
+			return QueryParam{CType: "int", Value: "0"}, nil
+		}
+	case "int":
+		if tok.Type == lexer.INT {
+			return QueryParam{CType: "int64_t", Value: sign + tok.Literal + "LL"}, nil
+		}
+	case "float":
+		if tok.Type == lexer.INT || tok.Type == lexer.FLOAT {
+			return QueryParam{CType: "double", Value: sign + tok.Literal}, nil
+		}
+	case "string", "date", "datetime":
+		if sign == "" && tok.Type == lexer.STRING {
+			return QueryParam{CType: "char*", Value: cString(tok.Literal)}, nil
+		}
+	}
+	return QueryParam{}, fmt.Errorf("%s %s cannot be compared with %s", f.Type, f.Name, sign+tok.Literal)
+}
+
+// compileStat lowers a Stat source such as Todo.count(where completed) or
+// Todo.avg(priority where !completed) to a single aggregate query
+func (g *TemplateGenerator) compileStat(src string) (StatData, error) {
+	stat := StatData{Source: src}
+	q := newQueryParser(src)
+	if err := q.structRef(g.structs); err != nil {
+		return stat, fmt.Errorf("Stat %s: %w", src, err)
+	}
+	stat.Struct = q.s.Name
+
+	fn, err := q.expect(lexer.IDENT)
+	if err != nil {
+		return stat, fmt.Errorf("Stat %s: %w", src, err)
+	}
+	if _, err := q.expect(lexer.LPAREN); err != nil {
+		return stat, fmt.Errorf("Stat %s: %w", src, err)
+	}
+
+	var column string
+	switch fn.Literal {
+	case "count":
+		column = "COUNT(*)"
+	case "sum", "avg", "min", "max":
+		f, err := q.field()
+		if err != nil {
+			return stat, fmt.Errorf("Stat %s: %w", src, err)
+		}
+		if f.Type != "int" && f.Type != "float" {
+			return stat, fmt.Errorf("Stat %s: %s is not numeric", src, f.Name)
+		}
+		column = fmt.Sprintf("%s(%s)", strings.ToUpper(fn.Literal), f.Name)
+		if fn.Literal == "sum" {
+			column = fmt.Sprintf("TOTAL(%s)", f.Name)
+			if f.Type == "int" {
+				column = fmt.Sprintf("COALESCE(SUM(%s), 0)", f.Name)
+			}
+		}
+	default:
+		return stat, fmt.Errorf("Stat %s: unknown aggregate %s (count, sum, avg, min or max)", src, fn.Literal)
+	}
+
+	stat.SQL = fmt.Sprintf("SELECT %s FROM %s", column, g.getTableName(q.s))
+	if q.cur().Type == lexer.IDENT && q.cur().Literal == "where" {
+		q.next()
+		cond, err := q.where()
+		if err != nil {
+			return stat, fmt.Errorf("Stat %s: %w", src, err)
+		}
+		stat.SQL += " WHERE " + cond
+	}
+	if _, err := q.expect(lexer.RPAREN); err != nil {
+		return stat, fmt.Errorf("Stat %s: %w", src, err)
+	}
+	if q.cur().Type != lexer.EOF {
+		return stat, fmt.Errorf("Stat %s: unexpected %q", src, q.cur().Literal)
+	}
+	stat.Params = q.params
+	return stat, nil
+}
+
+// pageStats compiles the Stat components of the page, numbering them per
+// struct in page order
+func (g *TemplateGenerator) pageStats() ([]StatData, error) {
+	stats := []StatData{}
+	if len(g.pages) == 0 {
+		return stats, nil
+	}
+
+	counts := map[string]int{}
+	for _, node := range g.pages[0].Body {
+		decl, ok := node.(*ast.StatDecl)
+		if !ok {
+			continue
+		}
+		src, _ := decl.Properties["value"].(string)
+		if src == "" {
+			return nil, fmt.Errorf("Stat needs value: Model.count(...)")
+		}
+		stat, err := g.compileStat(src)
+		if err != nil {
+			return nil, err
+		}
+		counts[stat.Struct]++
+		stat.Index = counts[stat.Struct]
+		label, _ := decl.Properties["label"].(string)
+		if label == "" {
+			label = src
+		}
+		stat.Label = cString(html.EscapeString(label))
+		stats = append(stats, stat)
+	}
+	return stats, nil
+}
+
+// ListQuery is a compiled DataList: its source, such as
+// Todo.where(completed == false).order(id desc).limit(50), plus the
+// columns and pageSize it declares
+type ListQuery struct {
+	Struct   *ast.StructDecl
+	Where    string // SQL condition, with ? for each of Params
+	Params   []QueryParam
+	Order    string // SQL ORDER BY list; empty for id order
+	Limit    int
+	Columns  []string
+	PageSize int
+	Include  []string // References joined into each row, from include: [...]
+	Search   bool     // search: true puts a full-text search box over the list
+}
+
+// Custom reports whether the list needs its own statements rather than
+// Model_all / Model_page
+func (l *ListQuery) Custom() bool {
+	if len(l.Include) > 0 {
+		return false // Model_*_including, whatever the columns
+	}
+	return l.Where != "" || l.Order != "" || l.Limit > 0 || len(l.Columns) > 0
+}
+
+// compileListSource lowers a DataList source: Model.all() or a chain of
+// where(cond), order(field [asc|desc], ...) and limit(n)
+func (g *TemplateGenerator) compileListSource(src string) (ListQuery, error) {
+	list := ListQuery{}
+	q := newQueryParser(src)
+	if err := q.structRef(g.structs); err != nil {
+		return list, fmt.Errorf("DataList source %s: %w", src, err)
+	}
+	list.Struct = q.s
+
+	seen := map[string]bool{}
+	for {
+		method, err := q.expect(lexer.IDENT)
+		if err != nil {
+			return list, fmt.Errorf("DataList source %s: %w", src, err)
+		}
+		if seen[method.Literal] {
+			return list, fmt.Errorf("DataList source %s: %s() given twice", src, method.Literal)
+		}
+		seen[method.Literal] = true
+		if _, err := q.expect(lexer.LPAREN); err != nil {
+			return list, fmt.Errorf("DataList source %s: %w", src, err)
+		}
+
+		switch method.Literal {
+		case "all":
+		case "where":
+			list.Where, err = q.where()
+		case "order":
+			list.Order, err = q.order()
+		case "limit":
+			var tok lexer.Token
+			tok, err = q.expect(lexer.INT)
+			if err == nil {
+				list.Limit, err = strconv.Atoi(tok.Literal)
+				if err == nil && list.Limit < 1 {
+					err = fmt.Errorf("limit must be positive")
+				}
+			}
+		default:
+			err = fmt.Errorf("unknown method %s (all, where, order or limit)", method.Literal)
+		}
+		if err != nil {
+			return list, fmt.Errorf("DataList source %s: %w", src, err)
+		}
+		if _, err := q.expect(lexer.RPAREN); err != nil {
+			return list, fmt.Errorf("DataList source %s: %w", src, err)
+		}
+
+		if q.cur().Type == lexer.EOF {
+			break
+		}
+		if _, err := q.expect(lexer.DOT); err != nil {
+			return list, fmt.Errorf("DataList source %s: %w", src, err)
+		}
+	}
+
+	list.Params = q.params
+	return list, nil
+}
+
+// order reads field [asc|desc] {, field [asc|desc]} into an ORDER BY list.
+// Ordering by id alone, ascending, is the natural order and yields "".
+func (q *queryParser) order() (string, error) {
+	terms := []string{}
+	for {
+		f, err := q.field()
+		if err != nil {
+			return "", err
+		}
+		term := f.Name
+		if q.cur().Type == lexer.IDENT {
+			switch strings.ToLower(q.cur().Literal) {
+			case "asc":
+			case "desc":
+				term += " DESC"
+			default:
+				return "", fmt.Errorf("expected asc or desc, got %q", q.cur().Literal)
+			}
+			q.next()
+		}
+		terms = append(terms, term)
+
+		if q.cur().Type != lexer.COMMA {
+			break
+		}
+		q.next()
+	}
+
+	if len(terms) == 1 && terms[0] == "id" {
+		return "", nil
+	}
+	return strings.Join(terms, ", "), nil
+}
+
+// dataList compiles the page's DataList, or returns nil when the page has
+// none. Without a source it lists the first struct.
+func (g *TemplateGenerator) dataList() (*ListQuery, error) {
+	if len(g.pages) == 0 || len(g.structs) == 0 {
+		return nil, nil
+	}
+	decl := findDataList(g.pages[0])
+	if decl == nil {
+		return nil, nil
+	}
+
+	list := ListQuery{Struct: g.structs[0]}
+	if src, _ := decl.Properties["source"].(string); src != "" {
+		var err error
+		if list, err = g.compileListSource(src); err != nil {
+			return nil, err
+		}
+	}
+
+	// include: [owner] joins the rows the listed references name into the
+	// list, so columns can show them as owner.name
+	list.Include, _ = decl.Properties["include"].([]string)
+	for _, name := range list.Include {
+		if g.reference(list.Struct, name) == nil {
+			return nil, fmt.Errorf("DataList include: struct %s has no struct-typed field %s", list.Struct.Name, name)
+		}
+	}
+	if len(list.Include) > 0 && (list.Where != "" || list.Order != "" || list.Limit > 0) {
+		return nil, fmt.Errorf("DataList include cannot be combined with where(), order() or limit()")
+	}
+
+	list.Columns, _ = decl.Properties["columns"].([]string)
+	for _, name := range list.Columns {
+		s, field := list.Struct, name
+		if via, rest, ok := strings.Cut(name, "."); ok {
+			included := false
+			for _, inc := range list.Include {
+				included = included || inc == via
+			}
+			if !included {
+				return nil, fmt.Errorf("DataList columns: %s needs include: [%s]", name, via)
+			}
+			s, field = g.structNamed(g.reference(list.Struct, via).Struct), rest
+		}
+		found := false
+		for _, f := range s.Fields {
+			if f.Name == field && !f.IsArray {
+				found = true
+			}
+		}
+		if !found {
+			return nil, fmt.Errorf("DataList columns: struct %s has no field %s", s.Name, field)
+		}
+	}
+
+	if search, ok := decl.Properties["search"].(string); ok {
+		if search != "true" && search != "false" {
+			return nil, fmt.Errorf("DataList search: expected true or false, got %s", search)
+		}
+		list.Search = search == "true"
+	}
+	if list.Search {
+		searchable := false
+		for _, field := range list.Struct.Fields {
+			searchable = searchable || hasDecorator(field.Decorators, "searchable")
+		}
+		if !searchable {
+			return nil, fmt.Errorf("DataList search: struct %s has no @searchable field", list.Struct.Name)
+		}
+	}
+
+	if size, ok := decl.Properties["pageSize"].(string); ok {
+		n, err := strconv.Atoi(size)
+		if err != nil || n < 1 {
+			return nil, fmt.Errorf("DataList pageSize: expected a positive count, got %s", size)
+		}
+		list.PageSize = n
+	}
+	// Pages are keyed on id, so they need the list in id order
+	if list.PageSize > 0 && (list.Order != "" || list.Limit > 0) {
+		return nil, fmt.Errorf("DataList pageSize pages in id order; it cannot be combined with order() or limit()")
+	}
+	return &list, nil
+}
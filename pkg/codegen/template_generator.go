@@ -4,6 +4,7 @@ import (
 	"bytes"
 	"embed"
 	"fmt"
+	"strconv"
 	"strings"
 	"text/template"
 
@@ -20,11 +21,18 @@ type TemplateGenerator struct {
 	pages     []*ast.PageDecl
 	handlers  []*ast.HandlerDecl
 	hasWeb    bool
+	storage   StorageData
+	stats     []StatData
+	list      *ListQuery // The page's DataList, nil without one
+
+	// Fields typed as another struct, by struct name
+	references map[string][]ReferenceData
 }
 
 // Template data structures
 type FieldData struct {
 	Name            string
+	Upper           string
 	CType           string
 	SQLType         string
 	Constraints     string
@@ -32,6 +40,43 @@ type FieldData struct {
 	IsBool          bool
 	IsArray         bool
 	IsAutoIncrement bool
+	IsPrimary       bool
+	Bit             int // Column position, used for Model_FIELD_* bits
+
+	// Inline is N for a string stored in the struct as char[N + 1] plus a
+	// LenType length (@length(max: N) at or under the inline threshold);
+	// 0 for a char* string
+	Inline  int
+	LenType string
+
+	// Via is the reference a DataList column is read through (owner for
+	// owner.name), or empty for a column of the listed struct itself
+	Via string
+}
+
+// ReferenceData is a field typed as another struct (User owner;). It is
+// stored as an owner_id column, and Model_*_including joins the row it
+// names back in as Model.owner.
+type ReferenceData struct {
+	Field    string // owner
+	Upper    string // OWNER, for Model_INCLUDE_OWNER
+	Column   string // owner_id
+	Struct   string // User
+	Bit      int    // Position among the struct's references
+	Select   string // ", r0.id, r0.name": the referenced columns
+	Join     string // " LEFT JOIN users r0 ON r0.id = t.owner_id"
+	Columns  int    // Number of columns Select adds
+	IDColumn int    // Position of id among them
+}
+
+// MigrateColumnData is a declared column as the migrator compares it
+type MigrateColumnData struct {
+	Name    string
+	SQLType string
+	Fill    string // Value for existing rows when the column is NOT NULL
+	NotNull bool
+	Primary bool
+	Unique  bool
 }
 
 type ParamData struct {
@@ -51,21 +96,106 @@ type HTMLTemplateData struct {
 	PageTitle     string
 	HasDataList   bool
 	HasForm       bool
+	PageSize      int
 	StructName    string
 	TableName     string
 	Fields        []FieldData
+	Columns       []FieldData // Fields the DataList shows
+	ListPrefix    string      // "list_" when the DataList reads a projection
+	ListSuffix    string      // "_including" when it joins in references
+	ListArgs      string      // Leading arguments: the include mask
+	Snapshot      bool        // The DataList shows the shared table snapshot
+	Stream        bool        // The DataList renders views straight from a cursor
+	Search        bool        // The DataList has a full-text search box
+	RowBytes      int         // Room a DataList row needs, besides its text cells
+	Stats         []StatData
 	FormFields    []FormFieldData
 }
 
+// StorageData is the connection profile from @storage(sqlite, key: value, ...)
+type StorageData struct {
+	Path        string // A C string literal
+	BusyTimeout int
+	Pragmas     []string
+	WAL         bool // Reads get a connection per thread
+
+	// Group commit: Model_create_async batches up to GroupCommitRows rows,
+	// waiting at most GroupCommitMs for more. Off when GroupCommitRows is 0.
+	GroupCommitRows int
+	GroupCommitMs   int
+
+	// Strings with @length(max: N) up to this are stored inline in the row
+	InlineMax int
+
+	// Some struct has @cache, so table versions must see other processes' writes
+	Cached bool
+}
+
+// StmtData describes one entry in a struct's prepared statement table
+type StmtData struct {
+	Name  string
+	SQL   string
+	Write bool // Runs on the writer connection
+}
+
+// CompositeIndexData describes a struct-level @index(fields: [...])
+type CompositeIndexData struct {
+	Suffix  string // a_b, used in function and type names
+	Upper   string // A_B, used in statement names
+	Columns string // a, b
+	Fields  []FieldData
+}
+
+// IndexData describes a secondary index created by Model_init_table
+type IndexData struct {
+	Name string
+	SQL  string
+}
+
 type CRUDTemplateData struct {
-	StructName   string
-	TableName    string
-	Params       []ParamData
-	BindFields   []FieldData
-	AllFields    []FieldData
-	Fields       []FieldData
-	FieldNames   string
-	Placeholders string
+	StructName       string
+	TableName        string
+	Params           []ParamData
+	BindFields       []FieldData
+	AllFields        []FieldData
+	Fields           []FieldData
+	FieldNames       string
+	Placeholders     string
+	Statements       []StmtData
+	RowIDField       string      // Caller-supplied integer primary key, if any
+	UpsertKeys       []FieldData // @unique and caller-supplied @primary columns
+	InlineFields     []FieldData // Strings stored inline, with their max length
+	Indexes          []IndexData
+	IndexedFields    []FieldData
+	CompositeIndexes []CompositeIndexData
+	UpdateFields     []FieldData  // Columns Model_update may write
+	UpdateSQLMax     int          // Buffer size for the longest UPDATE statement
+	ListFields       []FieldData  // Columns the DataList projection selects
+	ListParams       []QueryParam // Bound by the DataList's where(), ahead of paging
+	ListParamCount   int
+	GroupCommit      bool        // Generate Model_create_async
+	NumericFields    []FieldData // Fields with sum/min/max/avg
+	Stats            []StatData  // Stat components that query this struct
+
+	// Row cache from @cache(rows: N); CacheShards is 0 without one
+	CacheShards    int
+	CacheShardRows int
+	CacheBuckets   int
+	Snapshot       bool // @cache(snapshot: true): Model_snapshot shares the whole table
+
+	// The declaration the migrator brings an existing table up to
+	MigrateColumns []MigrateColumnData
+	ColumnDefs     string // Column definitions of CREATE TABLE
+
+	// Fields typed as another struct, and the JOIN queries that fill them
+	References     []ReferenceData
+	IncludeColumns string // The struct's own columns, qualified with t.
+	IncludeSQLMax  int    // Buffer size for the longest include query
+
+	// @searchable fields, indexed by the FTS5 table SearchTable
+	SearchFields  []FieldData
+	SearchTable   string
+	SearchColumns string // title, description
 }
 
 // NewTemplateGenerator creates a new template-based generator
@@ -79,6 +209,16 @@ func NewTemplateGenerator() (*TemplateGenerator, error) {
 		"len":    func(v interface{}) int { return len(v.([]FieldData)) },
 		"title":  strings.Title,
 		"printf": fmt.Sprintf,
+		// ownsStrings reports whether a row holding fields keeps string
+		// copies after the struct, that is whether any is a non-inline string
+		"ownsStrings": func(fields []FieldData) bool {
+			for _, f := range fields {
+				if f.CType == "char*" && f.Inline == 0 {
+					return true
+				}
+			}
+			return false
+		},
 	}
 
 	// Parse all templates
@@ -114,9 +254,97 @@ func (g *TemplateGenerator) Generate(program *ast.Program) (string, error) {
 		}
 	}
 
+	if err := g.resolveReferences(); err != nil {
+		return "", err
+	}
+
+	storage, err := g.storageProfile()
+	if err != nil {
+		return "", err
+	}
+	storage.Cached = g.anyCache()
+	g.storage = storage
+
+	stats, err := g.pageStats()
+	if err != nil {
+		return "", err
+	}
+	g.stats = stats
+
+	list, err := g.dataList()
+	if err != nil {
+		return "", err
+	}
+	g.list = list
+
 	// Generate headers (still using direct code for now)
 	g.generateHeaders(&output)
 
+	// Generate db_open with the @storage tuning profile
+	if err := g.templates.ExecuteTemplate(&output, "db_open.tmpl", storage); err != nil {
+		return "", fmt.Errorf("failed to execute db_open template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the connection pool CRUD functions take connections from
+	if err := g.templates.ExecuteTemplate(&output, "db_pool.tmpl", storage); err != nil {
+		return "", fmt.Errorf("failed to execute db_pool template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the group commit writer
+	if storage.GroupCommitRows > 0 {
+		if err := g.templates.ExecuteTemplate(&output, "write_queue.tmpl", storage); err != nil {
+			return "", fmt.Errorf("failed to execute write_queue template: %w", err)
+		}
+		output.WriteString("\n")
+	}
+
+	// Generate the prepared statement cache shared by all CRUD functions
+	if err := g.templates.ExecuteTemplate(&output, "stmt_cache.tmpl", nil); err != nil {
+		return "", fmt.Errorf("failed to execute stmt_cache template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the arena that backs result sets
+	arena := struct{ Inline, Copied, Snippet bool }{
+		Inline: g.anyField(func(f *ast.FieldDecl) bool {
+			n, _, _ := g.inlineString(f)
+			return n > 0
+		}),
+		// Strings kept after the row
+		Copied: g.anyField(func(f *ast.FieldDecl) bool {
+			n, _, _ := g.inlineString(f)
+			return mapType(f.Type) == "char*" && n == 0
+		}),
+		Snippet: g.anyField(func(f *ast.FieldDecl) bool { return hasDecorator(f.Decorators, "searchable") }),
+	}
+	if err := g.templates.ExecuteTemplate(&output, "result_arena.tmpl", arena); err != nil {
+		return "", fmt.Errorf("failed to execute result_arena template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the CSV/JSONL tokenizers behind Model_import_*
+	float := struct{ Float bool }{
+		Float: g.anyField(func(f *ast.FieldDecl) bool { return mapType(f.Type) == "double" }),
+	}
+	if err := g.templates.ExecuteTemplate(&output, "import.tmpl", float); err != nil {
+		return "", fmt.Errorf("failed to execute import template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the buffered writer behind Model_export
+	if err := g.templates.ExecuteTemplate(&output, "export.tmpl", float); err != nil {
+		return "", fmt.Errorf("failed to execute export template: %w", err)
+	}
+	output.WriteString("\n")
+
+	// Generate the schema migrator Model_init_table runs
+	if err := g.templates.ExecuteTemplate(&output, "migrate.tmpl", nil); err != nil {
+		return "", fmt.Errorf("failed to execute migrate template: %w", err)
+	}
+	output.WriteString("\n")
+
 	// Generate struct definitions using templates
 	for _, s := range g.structs {
 		if err := g.generateStructWithTemplate(&output, s); err != nil {
@@ -131,13 +359,21 @@ func (g *TemplateGenerator) Generate(program *ast.Program) (string, error) {
 		}
 	}
 
+	// Generate the command line (import, export) shared by both mains
+	if err := g.templates.ExecuteTemplate(&output, "app_commands.tmpl", g.mainData()); err != nil {
+		return "", fmt.Errorf("failed to execute app_commands template: %w", err)
+	}
+	output.WriteString("\n")
+
 	// Generate web server if needed
 	if g.hasWeb {
 		if err := g.generateWebServerWithTemplates(&output); err != nil {
 			return "", err
 		}
 	} else {
-		g.generateMainOld(&output)
+		if err := g.templates.ExecuteTemplate(&output, "cli_main.tmpl", g.mainData()); err != nil {
+			return "", fmt.Errorf("failed to execute cli_main template: %w", err)
+		}
 	}
 
 	return output.String(), nil
@@ -148,15 +384,34 @@ func (g *TemplateGenerator) generateHeaders(output *bytes.Buffer) {
 	output.WriteString(`#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sqlite3.h>
 `)
+	if g.storage.GroupCommitRows > 0 {
+		output.WriteString(`#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+`)
+	} else if g.anySnapshot() {
+		output.WriteString("#include <sched.h>\n#include <pthread.h>\n")
+	}
 	if g.hasWeb {
 		output.WriteString(`#include <ctype.h>
 #include <microhttpd.h>
 `)
 	}
 	output.WriteString(`
-// Global database connection
+// Global database connection: the writer of the connection pool
 sqlite3 *db = NULL;
 
 `)
@@ -173,7 +428,22 @@ func (g *TemplateGenerator) generateCRUDWithTemplates(output *bytes.Buffer, s *a
 	tableName := g.getTableName(s)
 
 	// Prepare data for templates
-	data := g.prepareCRUDData(s, tableName)
+	data, err := g.prepareCRUDData(s, tableName)
+	if err != nil {
+		return err
+	}
+
+	// Generate row allocation and the optional row cache
+	if err := g.templates.ExecuteTemplate(output, "crud_cache.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_cache template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate statement table
+	if err := g.templates.ExecuteTemplate(output, "crud_stmts.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_stmts template: %w", err)
+	}
+	output.WriteString("\n\n")
 
 	// Generate CREATE function
 	if err := g.templates.ExecuteTemplate(output, "crud_create.tmpl", data); err != nil {
@@ -181,6 +451,18 @@ func (g *TemplateGenerator) generateCRUDWithTemplates(output *bytes.Buffer, s *a
 	}
 	output.WriteString("\n\n")
 
+	// Generate UPSERT functions for structs with unique keys
+	if err := g.templates.ExecuteTemplate(output, "crud_upsert.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_upsert template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate queued CREATE for group commit
+	if err := g.templates.ExecuteTemplate(output, "crud_async.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_async template: %w", err)
+	}
+	output.WriteString("\n\n")
+
 	// Generate FIND function
 	if err := g.templates.ExecuteTemplate(output, "crud_find.tmpl", data); err != nil {
 		return fmt.Errorf("failed to execute crud_find template: %w", err)
@@ -193,18 +475,84 @@ func (g *TemplateGenerator) generateCRUDWithTemplates(output *bytes.Buffer, s *a
 	}
 	output.WriteString("\n\n")
 
+	// Generate indexed FIND_BY/FIRST_BY functions
+	if err := g.templates.ExecuteTemplate(output, "crud_index.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_index template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate UPDATE function and setters
+	if err := g.templates.ExecuteTemplate(output, "crud_update.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_update template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate keyset PAGE functions
+	if err := g.templates.ExecuteTemplate(output, "crud_page.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_page template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate ALL/PAGE variants that join in referenced rows
+	if err := g.templates.ExecuteTemplate(output, "crud_include.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_include template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate aggregate functions
+	if err := g.templates.ExecuteTemplate(output, "crud_aggregate.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_aggregate template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate streaming cursor and EACH function
+	if err := g.templates.ExecuteTemplate(output, "crud_each.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_each template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate projected LIST functions for the DataList
+	if err := g.templates.ExecuteTemplate(output, "crud_list.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_list template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate composite index RANGE_BY scans
+	if err := g.templates.ExecuteTemplate(output, "crud_range.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_range template: %w", err)
+	}
+	output.WriteString("\n\n")
+
 	// Generate DELETE function
 	if err := g.templates.ExecuteTemplate(output, "crud_delete.tmpl", data); err != nil {
 		return fmt.Errorf("failed to execute crud_delete template: %w", err)
 	}
 	output.WriteString("\n\n")
 
+	// Generate full-text SEARCH for @searchable fields
+	if err := g.templates.ExecuteTemplate(output, "crud_search.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_search template: %w", err)
+	}
+	output.WriteString("\n\n")
+
 	// Generate INIT_TABLE function
 	if err := g.templates.ExecuteTemplate(output, "crud_init_table.tmpl", data); err != nil {
 		return fmt.Errorf("failed to execute crud_init_table template: %w", err)
 	}
 	output.WriteString("\n\n")
 
+	// Generate CSV/JSONL bulk import
+	if err := g.templates.ExecuteTemplate(output, "crud_import.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_import template: %w", err)
+	}
+	output.WriteString("\n\n")
+
+	// Generate CSV/JSONL bulk export
+	if err := g.templates.ExecuteTemplate(output, "crud_export.tmpl", data); err != nil {
+		return fmt.Errorf("failed to execute crud_export template: %w", err)
+	}
+	output.WriteString("\n\n")
+
 	return nil
 }
 
@@ -213,19 +561,36 @@ func (g *TemplateGenerator) generateStructWithTemplate(output *bytes.Buffer, s *
 	type StructTemplateData struct {
 		StructName string
 		Fields     []FieldData
+		References []ReferenceData
 	}
 
 	data := StructTemplateData{
 		StructName: s.Name,
 		Fields:     []FieldData{},
+		References: g.references[s.Name],
 	}
 
+	bit := 0
 	for _, field := range s.Fields {
+		inline, lenType, err := g.inlineString(field)
+		if err != nil {
+			return fmt.Errorf("struct %s: %w", s.Name, err)
+		}
 		data.Fields = append(data.Fields, FieldData{
 			Name:    field.Name,
+			Upper:   strings.ToUpper(field.Name),
 			CType:   mapType(field.Type),
 			IsArray: field.IsArray,
+			Bit:     bit,
+			Inline:  inline,
+			LenType: lenType,
 		})
+		if !field.IsArray {
+			bit++
+		}
+	}
+	if bit > 32 {
+		return fmt.Errorf("struct %s: at most 32 columns are supported, got %d", s.Name, bit)
 	}
 
 	if err := g.templates.ExecuteTemplate(output, "struct_def.tmpl", data); err != nil {
@@ -247,9 +612,12 @@ func (g *TemplateGenerator) generateWebServerWithTemplates(output *bytes.Buffer)
 	// Generate page rendering function
 	if len(g.pages) > 0 && len(g.structs) > 0 {
 		page := g.pages[0]
-		s := g.structs[0]
+		s := g.pageStruct()
 
-		data := g.prepareHTMLData(page, s)
+		data, err := g.prepareHTMLData(page, s)
+		if err != nil {
+			return err
+		}
 
 		if err := g.templates.ExecuteTemplate(output, "html_page.tmpl", data); err != nil {
 			return fmt.Errorf("failed to execute html_page template: %w", err)
@@ -260,8 +628,11 @@ func (g *TemplateGenerator) generateWebServerWithTemplates(output *bytes.Buffer)
 	// Generate HTTP route handler using template
 	if len(g.pages) > 0 && len(g.structs) > 0 {
 		page := g.pages[0]
-		s := g.structs[0]
-		data := g.prepareHTMLData(page, s)
+		s := g.pageStruct()
+		data, err := g.prepareHTMLData(page, s)
+		if err != nil {
+			return err
+		}
 
 		// Convert FormFields to FieldData for the handler template
 		handlerData := struct {
@@ -269,11 +640,13 @@ func (g *TemplateGenerator) generateWebServerWithTemplates(output *bytes.Buffer)
 			TableName     string
 			PageNameLower string
 			FormFields    []FieldData
+			GroupCommit   bool
 		}{
 			StructName:    data.StructName,
 			TableName:     data.TableName,
 			PageNameLower: data.PageNameLower,
 			FormFields:    []FieldData{},
+			GroupCommit:   g.storage.GroupCommitRows > 0,
 		}
 
 		// Get non-auto fields for form processing
@@ -303,23 +676,7 @@ func (g *TemplateGenerator) generateWebServerWithTemplates(output *bytes.Buffer)
 	}
 
 	// Generate web main using template
-	mainData := struct {
-		Structs []struct {
-			Name string
-		}
-	}{
-		Structs: []struct {
-			Name string
-		}{},
-	}
-
-	for _, s := range g.structs {
-		mainData.Structs = append(mainData.Structs, struct {
-			Name string
-		}{Name: s.Name})
-	}
-
-	if err := g.templates.ExecuteTemplate(output, "web_main.tmpl", mainData); err != nil {
+	if err := g.templates.ExecuteTemplate(output, "web_main.tmpl", g.mainData()); err != nil {
 		return fmt.Errorf("failed to execute web_main template: %w", err)
 	}
 
@@ -327,14 +684,15 @@ func (g *TemplateGenerator) generateWebServerWithTemplates(output *bytes.Buffer)
 }
 
 // prepareCRUDData prepares data for CRUD templates
-func (g *TemplateGenerator) prepareCRUDData(s *ast.StructDecl, tableName string) CRUDTemplateData {
+func (g *TemplateGenerator) prepareCRUDData(s *ast.StructDecl, tableName string) (CRUDTemplateData, error) {
 	data := CRUDTemplateData{
-		StructName: s.Name,
-		TableName:  tableName,
-		Params:     []ParamData{},
-		BindFields: []FieldData{},
-		AllFields:  []FieldData{},
-		Fields:     []FieldData{},
+		StructName:  s.Name,
+		TableName:   tableName,
+		Params:      []ParamData{},
+		BindFields:  []FieldData{},
+		AllFields:   []FieldData{},
+		Fields:      []FieldData{},
+		GroupCommit: g.storage.GroupCommitRows > 0,
 	}
 
 	fieldNames := []string{}
@@ -360,41 +718,479 @@ func (g *TemplateGenerator) prepareCRUDData(s *ast.StructDecl, tableName string)
 		cType := mapType(field.Type)
 		fieldData := FieldData{
 			Name:            field.Name,
+			Upper:           strings.ToUpper(field.Name),
 			CType:           cType,
 			SQLType:         mapSQLType(field.Type),
 			Constraints:     getFieldConstraints(field),
 			IsAutoIncrement: isAuto && isPrimary,
+			IsPrimary:       isPrimary,
 			IsBool:          field.Type == "bool",
+			Bit:             len(data.Fields),
+		}
+		fieldData.Inline, fieldData.LenType, _ = g.inlineString(field)
+		if fieldData.Inline > 0 {
+			data.InlineFields = append(data.InlineFields, fieldData)
 		}
 
 		data.AllFields = append(data.AllFields, fieldData)
 		data.Fields = append(data.Fields, fieldData)
 
+		if hasDecorator(field.Decorators, "index") {
+			data.IndexedFields = append(data.IndexedFields, fieldData)
+		}
+
 		if !isAuto {
 			data.Params = append(data.Params, ParamData{
 				Type: cType,
 				Name: field.Name,
 			})
 			data.BindFields = append(data.BindFields, fieldData)
+			if isPrimary && field.Type == "int" {
+				data.RowIDField = field.Name
+			}
+			if isPrimary || hasDecorator(field.Decorators, "unique") {
+				data.UpsertKeys = append(data.UpsertKeys, fieldData)
+			}
 			fieldNames = append(fieldNames, field.Name)
 			placeholders = append(placeholders, "?")
 		}
 	}
 
+	// Reads name every column rather than SELECT *, so rows read the same
+	// on a table whose columns were added later by the migrator (in any
+	// order, next to columns no longer declared). Bulk import and export
+	// cover the same columns, auto ones included.
+	columns := []string{}
+	for _, f := range data.Fields {
+		columns = append(columns, f.Name)
+	}
+	selectColumns := strings.Join(columns, ", ")
+
+	defs := []string{}
+	for _, f := range data.Fields {
+		defs = append(defs, f.Name+" "+f.SQLType+f.Constraints)
+		fill := "0"
+		if f.SQLType == "TEXT" {
+			fill = "''"
+		}
+		data.MigrateColumns = append(data.MigrateColumns, MigrateColumnData{
+			Name:    f.Name,
+			SQLType: f.SQLType,
+			Fill:    fill,
+			NotNull: strings.Contains(f.Constraints, "NOT NULL"),
+			Primary: f.IsPrimary,
+			Unique:  strings.Contains(f.Constraints, "UNIQUE"),
+		})
+	}
+	data.ColumnDefs = strings.Join(defs, ", ")
+
+	qualified := []string{}
+	for _, name := range columns {
+		qualified = append(qualified, "t."+name)
+	}
+
+	// Include queries: this table as t, then each included reference's
+	// columns and LEFT JOIN, in declaration order
+	data.References = g.references[s.Name]
+	if len(data.References) > 0 {
+		data.IncludeColumns = strings.Join(qualified, ", ")
+		data.IncludeSQLMax = len("SELECT  FROM  t WHERE t.id < ? ORDER BY t.id DESC LIMIT ?") + len(data.IncludeColumns) + len(tableName) + 1
+		for _, ref := range data.References {
+			data.IncludeSQLMax += len(ref.Select) + len(ref.Join)
+		}
+	}
+
 	data.FieldNames = strings.Join(fieldNames, ", ")
 	data.Placeholders = strings.Join(placeholders, ", ")
 
-	return data
+	// Statement table, prepared once in Model_init_table
+	data.Statements = []StmtData{
+		{Name: "CREATE", SQL: fmt.Sprintf("INSERT INTO %s (%s) VALUES (%s)", tableName, data.FieldNames, data.Placeholders), Write: true},
+		{Name: "FIND", SQL: fmt.Sprintf("SELECT %s FROM %s WHERE id = ?", selectColumns, tableName)},
+		{Name: "ALL", SQL: fmt.Sprintf("SELECT %s FROM %s", selectColumns, tableName)},
+		{Name: "PAGE", SQL: fmt.Sprintf("SELECT %s FROM %s WHERE id > ? ORDER BY id LIMIT ?", selectColumns, tableName)},
+		{Name: "PAGE_BEFORE", SQL: fmt.Sprintf("SELECT * FROM (SELECT %s FROM %s WHERE id < ? ORDER BY id DESC LIMIT ?) ORDER BY id", selectColumns, tableName)},
+		{Name: "DELETE", SQL: fmt.Sprintf("DELETE FROM %s WHERE id = ?", tableName), Write: true},
+		{Name: "DELETE_MANY", SQL: fmt.Sprintf("DELETE FROM %s WHERE id IN (SELECT value FROM json_each(?))", tableName), Write: true},
+		{Name: "IMPORT", SQL: fmt.Sprintf("INSERT INTO %s (%s) VALUES (%s)", tableName, strings.Join(columns, ", "),
+			strings.TrimSuffix(strings.Repeat("?, ", len(columns)), ", ")), Write: true},
+		{Name: "EXPORT", SQL: fmt.Sprintf("SELECT %s FROM %s", selectColumns, tableName)},
+	}
+
+	// Upsert: one ON CONFLICT clause per caller-supplied unique key, each
+	// overwriting the row it collides with (SQLite runs the first that
+	// matches). DO UPDATE rather than DO NOTHING so RETURNING always yields
+	// the row's id.
+	if len(data.UpsertKeys) > 0 {
+		sets := []string{}
+		for _, f := range data.BindFields {
+			sets = append(sets, fmt.Sprintf("%s = excluded.%s", f.Name, f.Name))
+		}
+		clauses := []string{}
+		for _, key := range data.UpsertKeys {
+			clauses = append(clauses, fmt.Sprintf("ON CONFLICT(%s) DO UPDATE SET %s", key.Name, strings.Join(sets, ", ")))
+		}
+		data.Statements = append(data.Statements, StmtData{
+			Name:  "UPSERT",
+			SQL:   fmt.Sprintf("INSERT INTO %s (%s) VALUES (%s) %s RETURNING rowid", tableName, data.FieldNames, data.Placeholders, strings.Join(clauses, " ")),
+			Write: true,
+		})
+	}
+
+	// The DataList reads through its own statements when it projects
+	// columns: [...] (plus id, which its row actions and pager links need)
+	// or its source filters, orders or limits the rows
+	if list := g.list; list != nil && list.Struct == s && list.Custom() {
+		names := []string{}
+		if id, ok := findField(data.Fields, "id"); ok {
+			data.ListFields = append(data.ListFields, id)
+			names = append(names, id.Name)
+		}
+		columns := list.Columns
+		if len(columns) == 0 {
+			for _, f := range data.Fields {
+				columns = append(columns, f.Name)
+			}
+		}
+		for _, name := range columns {
+			f, _ := findField(data.Fields, name)
+			if f.Name == "id" {
+				continue
+			}
+			data.ListFields = append(data.ListFields, f)
+			names = append(names, f.Name)
+		}
+		data.ListParams = list.Params
+		data.ListParamCount = len(list.Params)
+
+		projection := strings.Join(names, ", ")
+		all := fmt.Sprintf("SELECT %s FROM %s", projection, tableName)
+		filter := ""
+		if list.Where != "" {
+			all += " WHERE " + list.Where
+			filter = "(" + list.Where + ") AND "
+		}
+		if list.Order != "" {
+			all += " ORDER BY " + list.Order
+		}
+		if list.Limit > 0 {
+			all += fmt.Sprintf(" LIMIT %d", list.Limit)
+		}
+		data.Statements = append(data.Statements,
+			StmtData{Name: "LIST_ALL", SQL: all},
+			StmtData{Name: "LIST_PAGE", SQL: fmt.Sprintf("SELECT %s FROM %s WHERE %sid > ? ORDER BY id LIMIT ?", projection, tableName, filter)},
+			StmtData{Name: "LIST_PAGE_BEFORE", SQL: fmt.Sprintf("SELECT * FROM (SELECT %s FROM %s WHERE %sid < ? ORDER BY id DESC LIMIT ?) ORDER BY id", projection, tableName, filter)},
+		)
+	}
+
+	// Aggregates: COUNT for every struct, SUM/MIN/MAX/AVG per numeric field
+	data.Statements = append(data.Statements, StmtData{Name: "COUNT_ROWS", SQL: fmt.Sprintf("SELECT COUNT(*) FROM %s", tableName)})
+	for _, f := range data.Fields {
+		if f.IsBool || f.IsPrimary || (f.CType != "int64_t" && f.CType != "double") {
+			continue
+		}
+		data.NumericFields = append(data.NumericFields, f)
+		sum := fmt.Sprintf("SELECT TOTAL(%s) FROM %s", f.Name, tableName)
+		if f.CType == "int64_t" {
+			sum = fmt.Sprintf("SELECT COALESCE(SUM(%s), 0) FROM %s", f.Name, tableName)
+		}
+		data.Statements = append(data.Statements,
+			StmtData{Name: "SUM_" + f.Upper, SQL: sum},
+			StmtData{Name: "MIN_" + f.Upper, SQL: fmt.Sprintf("SELECT MIN(%s) FROM %s", f.Name, tableName)},
+			StmtData{Name: "MAX_" + f.Upper, SQL: fmt.Sprintf("SELECT MAX(%s) FROM %s", f.Name, tableName)},
+			StmtData{Name: "AVG_" + f.Upper, SQL: fmt.Sprintf("SELECT AVG(%s) FROM %s", f.Name, tableName)},
+		)
+	}
+
+	// Page Stat components get their own statements
+	for _, stat := range g.stats {
+		if stat.Struct != s.Name {
+			continue
+		}
+		data.Stats = append(data.Stats, stat)
+		data.Statements = append(data.Statements, StmtData{Name: fmt.Sprintf("STAT_%d", stat.Index), SQL: stat.SQL})
+	}
+
+	// Every column except the primary key can be updated
+	updateSQLMax := len("UPDATE  SET  WHERE id = ?") + len(tableName) + 1
+	for _, f := range data.Fields {
+		if !f.IsPrimary {
+			data.UpdateFields = append(data.UpdateFields, f)
+			updateSQLMax += len(f.Name) + len(" = ?, ")
+		}
+	}
+	data.UpdateSQLMax = updateSQLMax
+
+	// @index fields get an index plus FIND_BY/FIRST_BY lookups
+	for _, f := range data.IndexedFields {
+		data.Indexes = append(data.Indexes, IndexData{
+			Name: fmt.Sprintf("idx_%s_%s", tableName, f.Name),
+			SQL:  fmt.Sprintf("CREATE INDEX IF NOT EXISTS idx_%s_%s ON %s (%s)", tableName, f.Name, tableName, f.Name),
+		})
+		data.Statements = append(data.Statements,
+			StmtData{Name: "FIND_BY_" + f.Upper, SQL: fmt.Sprintf("SELECT %s FROM %s WHERE %s = ? ORDER BY id", selectColumns, tableName, f.Name)},
+			StmtData{Name: "FIRST_BY_" + f.Upper, SQL: fmt.Sprintf("SELECT %s FROM %s WHERE %s = ? ORDER BY id LIMIT 1", selectColumns, tableName, f.Name)},
+		)
+	}
+
+	// @searchable fields share one FTS5 index whose content is the table
+	// itself (content_rowid id), so only the index is stored twice. SEARCH
+	// returns the row, its BM25 rank and a snippet of the best column, its
+	// matches between \x01 and \x02 until Model_search escapes it as HTML.
+	for _, field := range s.Fields {
+		if !hasDecorator(field.Decorators, "searchable") {
+			continue
+		}
+		if field.Type != "string" || field.IsArray {
+			return data, fmt.Errorf("struct %s: @searchable field %s must be a string", s.Name, field.Name)
+		}
+		f, _ := findField(data.Fields, field.Name)
+		data.SearchFields = append(data.SearchFields, f)
+	}
+	if len(data.SearchFields) > 0 {
+		if _, ok := findField(data.Fields, "id"); !ok {
+			return data, fmt.Errorf("struct %s: @searchable needs an id field", s.Name)
+		}
+		names := []string{}
+		for _, f := range data.SearchFields {
+			names = append(names, f.Name)
+		}
+		data.SearchTable = tableName + "_fts"
+		data.SearchColumns = strings.Join(names, ", ")
+		data.Statements = append(data.Statements, StmtData{
+			Name: "SEARCH",
+			SQL: fmt.Sprintf("SELECT %s, %s.rank, snippet(%s, -1, char(1), char(2), '...', 12) FROM %s JOIN %s t ON t.id = %s.rowid WHERE %s MATCH ? ORDER BY %s.rank LIMIT ? OFFSET ?",
+				strings.Join(qualified, ", "), data.SearchTable, data.SearchTable, data.SearchTable, tableName, data.SearchTable, data.SearchTable, data.SearchTable),
+		})
+	}
+
+	// Struct-level @index(fields: [a, b]) gets a composite index and a
+	// RANGE_BY scan that follows it (the index carries id as its last column)
+	for _, dec := range s.Decorators {
+		if dec.Name != "index" {
+			continue
+		}
+		names := dec.ListArgs["fields"]
+		if len(names) == 0 {
+			return data, fmt.Errorf("struct %s: @index needs fields: [...]", s.Name)
+		}
+
+		index := CompositeIndexData{
+			Suffix:  strings.Join(names, "_"),
+			Upper:   strings.ToUpper(strings.Join(names, "_")),
+			Columns: strings.Join(names, ", "),
+		}
+		for _, name := range names {
+			field, ok := findField(data.Fields, name)
+			if !ok {
+				return data, fmt.Errorf("struct %s: @index references unknown field %q", s.Name, name)
+			}
+			index.Fields = append(index.Fields, field)
+		}
+		data.CompositeIndexes = append(data.CompositeIndexes, index)
+
+		placeholders := strings.TrimSuffix(strings.Repeat("?, ", len(names)+1), ", ")
+		data.Indexes = append(data.Indexes, IndexData{
+			Name: fmt.Sprintf("idx_%s_%s", tableName, index.Suffix),
+			SQL:  fmt.Sprintf("CREATE INDEX IF NOT EXISTS idx_%s_%s ON %s (%s)", tableName, index.Suffix, tableName, index.Columns),
+		})
+		data.Statements = append(data.Statements, StmtData{
+			Name: "RANGE_BY_" + index.Upper,
+			SQL: fmt.Sprintf("SELECT %s FROM %s WHERE (%s, id) >= (%s) AND (%s, id) <= (%s) ORDER BY %s, id LIMIT ?",
+				selectColumns, tableName, index.Columns, placeholders, index.Columns, placeholders, index.Columns),
+		})
+	}
+
+	// @cache(rows: N): a row cache in front of Model_find, split into
+	// CacheShards shards with a power-of-two bucket table each.
+	// @cache(snapshot: true): a shared snapshot of the whole table.
+	for _, dec := range s.Decorators {
+		if dec.Name != "cache" {
+			continue
+		}
+		for key := range dec.KVArgs {
+			if key != "rows" && key != "snapshot" {
+				return data, fmt.Errorf("struct %s: @cache: unknown setting %s", s.Name, key)
+			}
+		}
+		if snapshot, ok := dec.KVArgs["snapshot"]; ok {
+			if snapshot != "true" && snapshot != "false" {
+				return data, fmt.Errorf("struct %s: @cache snapshot: expected true or false, got %s", s.Name, snapshot)
+			}
+			data.Snapshot = snapshot == "true"
+		}
+		value, ok := dec.KVArgs["rows"]
+		if !ok {
+			if !data.Snapshot {
+				return data, fmt.Errorf("struct %s: @cache needs rows: <count> or snapshot: true", s.Name)
+			}
+			continue
+		}
+		rows, err := strconv.Atoi(value)
+		if err != nil || rows < 1 {
+			return data, fmt.Errorf("struct %s: @cache needs rows: <count>, got %q", s.Name, value)
+		}
+		data.CacheShards = 1
+		for data.CacheShards < 16 && data.CacheShards*64 <= rows {
+			data.CacheShards *= 2
+		}
+		data.CacheShardRows = (rows + data.CacheShards - 1) / data.CacheShards
+		data.CacheBuckets = 1
+		for data.CacheBuckets < data.CacheShardRows {
+			data.CacheBuckets *= 2
+		}
+	}
+
+	return data, nil
+}
+
+// snapshotCached reports whether the struct has @cache(snapshot: true)
+func snapshotCached(s *ast.StructDecl) bool {
+	for _, dec := range s.Decorators {
+		if dec.Name == "cache" && dec.KVArgs["snapshot"] == "true" {
+			return true
+		}
+	}
+	return false
+}
+
+// anyCache reports whether some struct has a row cache or a snapshot
+func (g *TemplateGenerator) anyCache() bool {
+	for _, s := range g.structs {
+		for _, dec := range s.Decorators {
+			if dec.Name == "cache" {
+				return true
+			}
+		}
+	}
+	return false
+}
+
+// anySnapshot reports whether some struct keeps a table snapshot
+func (g *TemplateGenerator) anySnapshot() bool {
+	for _, s := range g.structs {
+		if snapshotCached(s) {
+			return true
+		}
+	}
+	return false
+}
+
+// resolveReferences lowers every field typed as another struct (User owner;)
+// to an integer owner_id column referencing that struct's table, keeping the
+// field's decorators, and records it in g.references. The lowered structs
+// replace the declared ones, so everything downstream sees plain columns.
+func (g *TemplateGenerator) resolveReferences() error {
+	byName := map[string]*ast.StructDecl{}
+	for _, s := range g.structs {
+		byName[s.Name] = s
+	}
+
+	g.references = map[string][]ReferenceData{}
+	lowered := make([]*ast.StructDecl, len(g.structs))
+	targets := map[string][]string{}
+	for i, s := range g.structs {
+		decl := *s
+		decl.Fields = make([]*ast.FieldDecl, len(s.Fields))
+		for j, field := range s.Fields {
+			target, ok := byName[field.Type]
+			if !ok || field.IsArray {
+				decl.Fields[j] = field
+				continue
+			}
+			column := field.Name + "_id"
+			for _, other := range s.Fields {
+				if other.Name == column {
+					return fmt.Errorf("struct %s: field %s is stored as %s, which is already a field", s.Name, field.Name, column)
+				}
+			}
+			decorators := append([]*ast.Decorator{}, field.Decorators...)
+			decorators = append(decorators, &ast.Decorator{Name: "references", Args: []string{g.getTableName(target)}})
+			decl.Fields[j] = &ast.FieldDecl{Name: column, Type: "int", Decorators: decorators}
+
+			refs := g.references[s.Name]
+			g.references[s.Name] = append(refs, ReferenceData{
+				Field:  field.Name,
+				Upper:  strings.ToUpper(field.Name),
+				Column: column,
+				Struct: target.Name,
+				Bit:    len(refs),
+				Join:   fmt.Sprintf(" LEFT JOIN %s r%d ON r%d.id = t.%s", g.getTableName(target), len(refs), len(refs), column),
+			})
+		}
+		lowered[i] = &decl
+	}
+
+	// The referenced columns, as the referenced struct reads them
+	for _, s := range lowered {
+		names := []string{}
+		for _, field := range s.Fields {
+			if !field.IsArray {
+				names = append(names, field.Name)
+			}
+		}
+		targets[s.Name] = names
+	}
+	for name, refs := range g.references {
+		for i := range refs {
+			ref := &refs[i]
+			ref.IDColumn = -1
+			for k, column := range targets[ref.Struct] {
+				ref.Select += fmt.Sprintf(", r%d.%s", ref.Bit, column)
+				if column == "id" {
+					ref.IDColumn = k
+				}
+			}
+			if ref.IDColumn < 0 {
+				return fmt.Errorf("struct %s: field %s references %s, which has no id field", name, ref.Field, ref.Struct)
+			}
+			ref.Columns = len(targets[ref.Struct])
+		}
+	}
+
+	g.structs = lowered
+	return nil
+}
+
+// reference returns s's struct-typed field name, or nil
+func (g *TemplateGenerator) reference(s *ast.StructDecl, name string) *ReferenceData {
+	refs := g.references[s.Name]
+	for i := range refs {
+		if refs[i].Field == name {
+			return &refs[i]
+		}
+	}
+	return nil
+}
+
+// structNamed returns the struct declared with name, or nil
+func (g *TemplateGenerator) structNamed(name string) *ast.StructDecl {
+	for _, s := range g.structs {
+		if s.Name == name {
+			return s
+		}
+	}
+	return nil
+}
+
+// findField looks up a field by name
+func findField(fields []FieldData, name string) (FieldData, bool) {
+	for _, f := range fields {
+		if f.Name == name {
+			return f, true
+		}
+	}
+	return FieldData{}, false
 }
 
 // prepareHTMLData prepares data for HTML templates
-func (g *TemplateGenerator) prepareHTMLData(page *ast.PageDecl, s *ast.StructDecl) HTMLTemplateData {
+func (g *TemplateGenerator) prepareHTMLData(page *ast.PageDecl, s *ast.StructDecl) (HTMLTemplateData, error) {
 	tableName := g.getTableName(s)
 
 	data := HTMLTemplateData{
 		PageNameLower: strings.ToLower(page.Name),
 		PageTitle:     page.Name,
-		HasDataList:   true,
+		HasDataList:   findDataList(page) != nil,
 		HasForm:       true,
 		StructName:    s.Name,
 		TableName:     tableName,
@@ -402,6 +1198,10 @@ func (g *TemplateGenerator) prepareHTMLData(page *ast.PageDecl, s *ast.StructDec
 		FormFields:    []FormFieldData{},
 	}
 
+	if g.list != nil {
+		data.PageSize = g.list.PageSize
+	}
+
 	// Prepare field data
 	for _, field := range s.Fields {
 		if field.IsArray {
@@ -452,7 +1252,236 @@ func (g *TemplateGenerator) prepareHTMLData(page *ast.PageDecl, s *ast.StructDec
 		}
 	}
 
-	return data
+	data.Stats = g.stats
+
+	// Show the DataList's columns in the order given, or every field. A
+	// column owner.name is read from the included owner row.
+	data.Columns = data.Fields
+	if g.list != nil && g.list.Struct == s {
+		if len(g.list.Columns) > 0 {
+			data.Columns = []FieldData{}
+			for _, name := range g.list.Columns {
+				via, field, ok := strings.Cut(name, ".")
+				if !ok {
+					f, _ := findField(data.Fields, name)
+					data.Columns = append(data.Columns, f)
+					continue
+				}
+				for _, target := range g.structNamed(g.reference(s, via).Struct).Fields {
+					if target.Name == field {
+						data.Columns = append(data.Columns, FieldData{
+							Name:   field,
+							CType:  mapType(target.Type),
+							Title:  strings.Title(via) + " " + strings.Title(field),
+							IsBool: target.Type == "bool",
+							Via:    via,
+						})
+					}
+				}
+			}
+		}
+		if g.list.Custom() {
+			data.ListPrefix = "list_"
+		}
+		if len(g.list.Include) > 0 {
+			bits := []string{}
+			for _, name := range g.list.Include {
+				bits = append(bits, s.Name+"_INCLUDE_"+strings.ToUpper(name))
+			}
+			data.ListSuffix = "_including"
+			data.ListArgs = strings.Join(bits, " | ") + ", "
+		}
+	}
+	data.Search = g.list != nil && g.list.Struct == s && g.list.Search
+	// Tags, the id links and up to 384 bytes per number cell (a %f double
+	// takes at most 317)
+	data.RowBytes = 1024 + len(data.TableName) + 384*len(data.Columns)
+	data.Snapshot = data.ListPrefix == "" && data.ListSuffix == "" && data.PageSize == 0 && snapshotCached(s)
+	data.Stream = data.ListSuffix == "" && data.PageSize == 0 && !data.Snapshot
+
+	return data, nil
+}
+
+// pageStruct is the struct the page lists and its form creates: the
+// DataList source's, or the first struct
+func (g *TemplateGenerator) pageStruct() *ast.StructDecl {
+	if g.list != nil {
+		return g.list.Struct
+	}
+	return g.structs[0]
+}
+
+// findDataList returns the page's DataList component, if it declares one
+func findDataList(page *ast.PageDecl) *ast.DataListDecl {
+	for _, node := range page.Body {
+		if dataList, ok := node.(*ast.DataListDecl); ok {
+			return dataList
+		}
+	}
+	return nil
+}
+
+// storageProfile reads the tuning arguments of @storage(sqlite, ...). Every
+// struct shares one database, so the settings may appear on any of them but
+// must not conflict.
+func (g *TemplateGenerator) storageProfile() (StorageData, error) {
+	storage := StorageData{Path: cString("app.db"), InlineMax: 255}
+	settings := map[string]string{}
+
+	for _, s := range g.structs {
+		for _, dec := range s.Decorators {
+			if dec.Name != "storage" {
+				continue
+			}
+			for key, value := range dec.KVArgs {
+				value = strings.Trim(value, `"`)
+				if prev, ok := settings[key]; ok && prev != value {
+					return storage, fmt.Errorf("@storage %s: conflicting values %s and %s", key, prev, value)
+				}
+				settings[key] = value
+			}
+		}
+	}
+
+	// Applied in this order: journal mode first, since synchronous=normal
+	// is only safe once WAL is on
+	for _, key := range []string{"path", "busy_timeout", "journal", "synchronous", "mmap", "cache", "temp_store", "group_commit", "group_commit_ms", "inline_strings"} {
+		value, ok := settings[key]
+		if !ok {
+			continue
+		}
+		delete(settings, key)
+
+		switch key {
+		case "path":
+			storage.Path = cString(value)
+		case "busy_timeout":
+			ms, err := strconv.Atoi(value)
+			if err != nil || ms < 0 {
+				return storage, fmt.Errorf("@storage busy_timeout: expected milliseconds, got %s", value)
+			}
+			storage.BusyTimeout = ms
+		case "journal":
+			if err := checkStorageValue(key, value, "wal", "delete", "truncate", "persist", "memory", "off"); err != nil {
+				return storage, err
+			}
+			storage.Pragmas = append(storage.Pragmas, "PRAGMA journal_mode = "+strings.ToLower(value))
+			storage.WAL = strings.EqualFold(value, "wal")
+		case "synchronous":
+			if err := checkStorageValue(key, value, "off", "normal", "full", "extra"); err != nil {
+				return storage, err
+			}
+			storage.Pragmas = append(storage.Pragmas, "PRAGMA synchronous = "+strings.ToLower(value))
+		case "mmap":
+			size, err := parseSize(value)
+			if err != nil {
+				return storage, fmt.Errorf("@storage mmap: %w", err)
+			}
+			storage.Pragmas = append(storage.Pragmas, fmt.Sprintf("PRAGMA mmap_size = %d", size))
+		case "cache":
+			size, err := parseSize(value)
+			if err != nil {
+				return storage, fmt.Errorf("@storage cache: %w", err)
+			}
+			// A negative cache_size is in KiB rather than pages
+			storage.Pragmas = append(storage.Pragmas, fmt.Sprintf("PRAGMA cache_size = -%d", size/1024))
+		case "temp_store":
+			if err := checkStorageValue(key, value, "default", "file", "memory"); err != nil {
+				return storage, err
+			}
+			storage.Pragmas = append(storage.Pragmas, "PRAGMA temp_store = "+strings.ToLower(value))
+		case "group_commit":
+			rows, err := strconv.Atoi(value)
+			if err != nil || rows < 1 {
+				return storage, fmt.Errorf("@storage group_commit: expected rows per batch, got %s", value)
+			}
+			storage.GroupCommitRows = rows
+			if storage.GroupCommitMs == 0 {
+				storage.GroupCommitMs = 10
+			}
+		case "group_commit_ms":
+			ms, err := strconv.Atoi(value)
+			if err != nil || ms < 0 {
+				return storage, fmt.Errorf("@storage group_commit_ms: expected milliseconds, got %s", value)
+			}
+			if storage.GroupCommitRows == 0 {
+				return storage, fmt.Errorf("@storage group_commit_ms needs group_commit")
+			}
+			storage.GroupCommitMs = ms
+		case "inline_strings":
+			max, err := strconv.Atoi(value)
+			if err != nil || max < 0 || max > 65535 {
+				return storage, fmt.Errorf("@storage inline_strings: expected a length up to 65535, got %s", value)
+			}
+			storage.InlineMax = max
+		}
+	}
+
+	for key := range settings {
+		return storage, fmt.Errorf("@storage: unknown setting %s", key)
+	}
+
+	// Without WAL the server runs one request thread, so a create handler
+	// waiting for its batch would hold up every other request
+	if storage.GroupCommitRows > 0 && !storage.WAL {
+		return storage, fmt.Errorf("@storage group_commit needs journal: wal")
+	}
+	return storage, nil
+}
+
+// checkStorageValue rejects a @storage value outside the allowed set
+func checkStorageValue(key, value string, allowed ...string) error {
+	for _, a := range allowed {
+		if strings.EqualFold(value, a) {
+			return nil
+		}
+	}
+	return fmt.Errorf("@storage %s: expected one of %s, got %s", key, strings.Join(allowed, ", "), value)
+}
+
+// parseSize reads a byte count such as 256MB, 64KB, 1GB or 4096
+func parseSize(value string) (int64, error) {
+	units := []struct {
+		suffix string
+		scale  int64
+	}{{"GB", 1 << 30}, {"MB", 1 << 20}, {"KB", 1 << 10}, {"G", 1 << 30}, {"M", 1 << 20}, {"K", 1 << 10}, {"B", 1}}
+
+	number, scale := strings.ToUpper(value), int64(1)
+	for _, u := range units {
+		if strings.HasSuffix(number, u.suffix) {
+			number, scale = strings.TrimSuffix(number, u.suffix), u.scale
+			break
+		}
+	}
+	n, err := strconv.ParseInt(number, 10, 64)
+	if err != nil || n < 0 {
+		return 0, fmt.Errorf("expected a size such as 256MB, got %s", value)
+	}
+	return n * scale, nil
+}
+
+// cString quotes s as a C string literal. Anything but printable ASCII is
+// written as a three-digit octal escape, which unlike \x cannot run into
+// the characters after it.
+func cString(s string) string {
+	var b strings.Builder
+	b.WriteByte('"')
+	for i := 0; i < len(s); i++ {
+		switch c := s[i]; {
+		case c == '"' || c == '\\':
+			b.WriteByte('\\')
+			b.WriteByte(c)
+		case c == '?':
+			// Not the start of a trigraph
+			b.WriteString(`\?`)
+		case c < 0x20 || c >= 0x7f:
+			fmt.Fprintf(&b, "\\%03o", c)
+		default:
+			b.WriteByte(c)
+		}
+	}
+	b.WriteByte('"')
+	return b.String()
 }
 
 // Helper function
@@ -499,6 +1528,58 @@ func mapSQLType(zlType string) string {
 	}
 }
 
+// anyField reports whether a column of any struct satisfies match
+func (g *TemplateGenerator) anyField(match func(*ast.FieldDecl) bool) bool {
+	for _, s := range g.structs {
+		for _, f := range s.Fields {
+			if !f.IsArray && match(f) {
+				return true
+			}
+		}
+	}
+	return false
+}
+
+// inlineString returns the inline capacity and length type for a string
+// field with @length(max: N), N at most the @storage inline_strings limit,
+// or 0 and "" to keep it a char*
+func (g *TemplateGenerator) inlineString(field *ast.FieldDecl) (int, string, error) {
+	if field.Type != "string" || field.IsArray {
+		return 0, "", nil
+	}
+	for _, dec := range field.Decorators {
+		if dec.Name != "length" {
+			continue
+		}
+		value, ok := dec.KVArgs["max"]
+		if !ok {
+			return 0, "", nil
+		}
+		max, err := strconv.Atoi(value)
+		if err != nil || max < 1 {
+			return 0, "", fmt.Errorf("@length max on %s: expected a positive length, got %s", field.Name, value)
+		}
+		if max > g.storage.InlineMax {
+			return 0, "", nil
+		}
+		if max < 256 {
+			return max, "uint8_t", nil
+		}
+		return max, "uint16_t", nil
+	}
+	return 0, "", nil
+}
+
+// hasDecorator reports whether a decorator with the given name is present
+func hasDecorator(decorators []*ast.Decorator, name string) bool {
+	for _, dec := range decorators {
+		if dec.Name == name {
+			return true
+		}
+	}
+	return false
+}
+
 func getFieldConstraints(field *ast.FieldDecl) string {
 	constraints := ""
 
@@ -512,15 +1593,23 @@ func getFieldConstraints(field *ast.FieldDecl) string {
 			constraints += " NOT NULL"
 		case "unique":
 			constraints += " UNIQUE"
+		case "references":
+			constraints += fmt.Sprintf(" REFERENCES %s(id)", dec.Args[0])
 		}
 	}
 
 	return constraints
 }
 
-// Old generation methods (temporary - to be replaced with templates)
-// generateMainOld generates CLI main with demo code (temporary - for CLI apps)
-func (g *TemplateGenerator) generateMainOld(output *bytes.Buffer) {
-	output.WriteString("// TODO: Generate CLI main using template\n")
-	output.WriteString("// For now, CLI apps use old c_generator.go\n")
+// MainTemplateData is what the mains and the command line need
+type MainTemplateData struct {
+	Structs     []*ast.StructDecl
+	GroupCommit bool
+}
+
+func (g *TemplateGenerator) mainData() MainTemplateData {
+	return MainTemplateData{
+		Structs:     g.structs,
+		GroupCommit: g.storage.GroupCommitRows > 0,
+	}
 }
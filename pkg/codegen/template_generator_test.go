@@ -1,6 +1,7 @@
 package codegen
 
 import (
+	"regexp"
 	"strings"
 	"testing"
 
@@ -84,6 +85,953 @@ func TestTemplateGenerator(t *testing.T) {
 	t.Logf("Generated code (first 500 chars):\n%s", code[:min(500, len(code))])
 }
 
+// todoStruct returns the Todo struct used by the generator tests
+func todoStruct() *ast.StructDecl {
+	return &ast.StructDecl{
+		Name: "Todo",
+		Decorators: []*ast.Decorator{
+			{Name: "storage", Args: []string{"sqlite"}},
+			{Name: "table", Args: []string{`"todos"`}},
+		},
+		Fields: []*ast.FieldDecl{
+			{Name: "id", Type: "int", Decorators: []*ast.Decorator{{Name: "primary"}, {Name: "autoincrement"}}},
+			{Name: "title", Type: "string", Decorators: []*ast.Decorator{{Name: "required"}}},
+			{Name: "completed", Type: "bool"},
+		},
+	}
+}
+
+// generate runs the template generator over the given statements
+func generate(t *testing.T, stmts ...ast.Node) string {
+	t.Helper()
+
+	gen, err := NewTemplateGenerator()
+	if err != nil {
+		t.Fatalf("Failed to create template generator: %v", err)
+	}
+
+	code, err := gen.Generate(&ast.Program{Statements: stmts})
+	if err != nil {
+		t.Fatalf("Failed to generate code: %v", err)
+	}
+	return code
+}
+
+func TestCRUDUsesStatementCache(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"SQLITE_PREPARE_PERSISTENT",
+		"static _Atomic(sqlite3_stmt*) Todo_stmts[Todo_STMT_COUNT];",
+		`"INSERT INTO todos (title, completed) VALUES (?, ?)",`,
+		"Todo_stmt(Todo_STMT_CREATE)",
+		"Todo_stmt(Todo_STMT_FIND)",
+		"Todo_stmt(Todo_STMT_ALL)",
+		"Todo_stmt(Todo_STMT_DELETE)",
+		"Todo_prepare_statements();",
+		"void Todo_finalize_statements()",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Cached statements are only ever prepared by the cache
+	if n := strings.Count(code, "sqlite3_prepare_v3"); n != 1 {
+		t.Errorf("Expected a single sqlite3_prepare_v3 call site, found %d", n)
+	}
+
+	// db_close finalizes the statements the cache owns, and only those
+	if !strings.Contains(code, "return db_stmt_own(stmt) ? stmt : NULL;") {
+		t.Error("Expected prepared statements to be registered with db_stmt_own")
+	}
+	if strings.Contains(code, "sqlite3_next_stmt") {
+		t.Error("db_close should not finalize statements it does not own")
+	}
+}
+
+func TestCreateManyBatchesInsert(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"int Todo_create_many(const Todo* rows, size_t n, int64_t* ids)",
+		"SQLITE_LIMIT_VARIABLE_NUMBER",
+		`"BEGIN IMMEDIATE"`,
+		`const char *tuple = "(?, ?)";`,
+		"Todo_bind_create_row(stmt, (int)(i * columns), &rows[done + i]);",
+		// Ids come from RETURNING, not from the last rowid
+		`const char *tail = " RETURNING rowid";`,
+		"ids[done + returned] = sqlite3_column_int64(stmt, 0);",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	start := strings.Index(code, "int Todo_create_many(")
+	end := start + strings.Index(code[start:], "\n}\n")
+	if start < 0 || strings.Contains(code[start:end], "sqlite3_last_insert_rowid") {
+		t.Error("create_many should not infer ids from the last rowid")
+	}
+}
+
+func TestCursorStreamsBorrowedRows(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"int Todo_cursor_open(Todo_cursor *cur)",
+		"const Todo* Todo_cursor_next(Todo_cursor *cur)",
+		"void Todo_cursor_close(Todo_cursor *cur)",
+		"int Todo_each(int (*callback)(const Todo* row, void* ctx), void* ctx)",
+		"row->title = (char*)view->title;",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+}
+
+func TestDataListPageSizeUsesKeysetPagination(t *testing.T) {
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{
+			&ast.DataListDecl{Properties: map[string]interface{}{
+				"source":   "Todo.all()",
+				"pageSize": "20",
+			}},
+		},
+	}
+	code := generate(t, todoStruct(), page)
+
+	expectedPatterns := []string{
+		`"SELECT id, title, completed FROM todos WHERE id > ? ORDER BY id LIMIT ?",`,
+		"Todo** Todo_page(int64_t after_id, int limit, int* count)",
+		"Todo** Todo_page_before(int64_t before_id, int limit, int* count)",
+		"char* render_todoapp_page(struct MHD_Connection *connection)",
+		"Todo_page(after_arg != NULL ? atoll(after_arg) : INT64_MIN, 20 + 1, &count);",
+		"href='?after=%lld'",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "= Todo_all(&count);") {
+		t.Error("Paged DataList should not load every row")
+	}
+}
+
+func TestIndexDecoratorGeneratesFinders(t *testing.T) {
+	s := todoStruct()
+	s.Fields[1].Decorators = append(s.Fields[1].Decorators, &ast.Decorator{Name: "index"})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		"CREATE INDEX IF NOT EXISTS idx_todos_title ON todos (title)",
+		`"SELECT id, title, completed FROM todos WHERE title = ? ORDER BY id",`,
+		"Todo** Todo_find_by_title(char* value, int* count)",
+		"Todo* Todo_first_by_title(char* value)",
+		"Todo_stmt(Todo_STMT_FIRST_BY_TITLE)",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "Todo_find_by_completed") {
+		t.Error("Only @index fields should get finders")
+	}
+}
+
+func TestCompositeIndexGeneratesRangeScan(t *testing.T) {
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "owner_id", Type: "int"})
+	s.Decorators = append(s.Decorators, &ast.Decorator{
+		Name:     "index",
+		ListArgs: map[string][]string{"fields": {"owner_id", "title"}},
+	})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		"CREATE INDEX IF NOT EXISTS idx_todos_owner_id_title ON todos (owner_id, title)",
+		"ORDER BY owner_id, title, id LIMIT ?",
+		"typedef struct Todo_owner_id_title_key {",
+		"int Todo_range_by_owner_id_title(const Todo_owner_id_title_key *lo, const Todo_owner_id_title_key *hi, int limit, Todo_cursor *cursor)",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Unknown fields are reported instead of producing broken SQL
+	s.Decorators[len(s.Decorators)-1].ListArgs["fields"] = []string{"missing"}
+	gen, _ := NewTemplateGenerator()
+	if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s}}); err == nil {
+		t.Error("Expected an error for @index on an unknown field")
+	}
+}
+
+func TestUpdateWritesOnlyDirtyColumns(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"uint32_t _dirty;",
+		"Todo_FIELD_TITLE = 1u << 1,",
+		"void Todo_set_title(Todo* obj, char* value)",
+		"obj->_dirty |= Todo_FIELD_TITLE;",
+		"int Todo_update(Todo* obj)",
+		`len += sprintf(sql + len, "%stitle = ?", sep);`,
+		"&Todo_update_stmts[mask % Todo_UPDATE_SLOTS]",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "Todo_set_id(") {
+		t.Error("The primary key should not get a setter")
+	}
+}
+
+func TestResultSetsAreArenaBacked(t *testing.T) {
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{&ast.DataListDecl{Properties: map[string]interface{}{"pageSize": "20"}}},
+	}
+	code := generate(t, todoStruct(), page)
+
+	expectedPatterns := []string{
+		"void Todo_result_free(Todo** results)",
+		"void Todo_free(Todo* obj)",
+		"results[n++] = read(stmt, &arena);",
+		"obj->title = arena_copy_text(&strings, title_text, title_len);",
+		"Todo_result_free(items);",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "->title = strdup(") {
+		t.Error("Rows should not strdup their strings")
+	}
+}
+
+func TestDataListColumnsProjectQuery(t *testing.T) {
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "description", Type: "string"})
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{
+			&ast.DataListDecl{Properties: map[string]interface{}{
+				"columns":  []string{"title", "completed"},
+				"pageSize": "20",
+			}},
+		},
+	}
+	code := generate(t, s, page)
+
+	expectedPatterns := []string{
+		`"SELECT id, title, completed FROM todos WHERE id > ? ORDER BY id LIMIT ?"`,
+		"#define Todo_LIST_FIELDS (Todo_FIELD_ID | Todo_FIELD_TITLE | Todo_FIELD_COMPLETED)",
+		"items = Todo_list_page(",
+		"items = Todo_list_page_before(",
+		"<th>Title</th>",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "<th>Description</th>") {
+		t.Error("DataList should only render its columns")
+	}
+
+	// Unknown columns are rejected
+	page.Body[0].(*ast.DataListDecl).Properties["columns"] = []string{"title", "due"}
+	gen, err := NewTemplateGenerator()
+	if err != nil {
+		t.Fatalf("Failed to create template generator: %v", err)
+	}
+	if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{todoStruct(), page}}); err == nil {
+		t.Error("Expected an error for a DataList column that is not a field")
+	}
+}
+
+func TestStorageTuningProfile(t *testing.T) {
+	s := todoStruct()
+	s.Decorators[0].KVArgs = map[string]string{
+		"journal":      "wal",
+		"synchronous":  "normal",
+		"mmap":         "256MB",
+		"cache":        "64MB",
+		"temp_store":   "memory",
+		"busy_timeout": "5000",
+		"path":         "data/app.db",
+	}
+	code := generate(t, s, &ast.PageDecl{Name: "TodoApp"})
+
+	expectedPatterns := []string{
+		`#define DB_PATH "data/app.db"`,
+		"sqlite3_busy_timeout(*conn, 5000);",
+		`"PRAGMA journal_mode = wal",`,
+		`"PRAGMA synchronous = normal",`,
+		`"PRAGMA mmap_size = 268435456",`,
+		`"PRAGMA cache_size = -65536",`,
+		`"PRAGMA temp_store = memory",`,
+		"if (!db_open(&db)) {",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Index(code, "journal_mode") > strings.Index(code, "synchronous =") {
+		t.Error("journal_mode should be set before synchronous")
+	}
+
+	// The path is quoted as a C string
+	s.Decorators[0].KVArgs = map[string]string{"path": `C:\data\"app".db`}
+	code = generate(t, s, &ast.PageDecl{Name: "TodoApp"})
+	if !strings.Contains(code, `#define DB_PATH "C:\\data\\\"app\".db"`) {
+		t.Error("DB_PATH should escape backslashes and quotes")
+	}
+
+	// Unknown settings and bad values are rejected
+	for _, bad := range []map[string]string{{"journal": "fast"}, {"mmap": "lots"}, {"pagesize": "4096"}} {
+		s := todoStruct()
+		s.Decorators[0].KVArgs = bad
+		gen, err := NewTemplateGenerator()
+		if err != nil {
+			t.Fatalf("Failed to create template generator: %v", err)
+		}
+		if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s}}); err == nil {
+			t.Errorf("Expected an error for @storage %v", bad)
+		}
+	}
+}
+
+func TestReadsUsePerThreadConnections(t *testing.T) {
+	s := todoStruct()
+	s.Decorators[0].KVArgs = map[string]string{"journal": "wal"}
+	code := generate(t, s, &ast.PageDecl{Name: "TodoApp"})
+
+	expectedPatterns := []string{
+		"#define DB_READ_POOL 1",
+		"static _Thread_local sqlite3 *db_read_conn = NULL;",
+		"SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX",
+		"static _Thread_local _Atomic(sqlite3_stmt*) Todo_read_stmts[Todo_STMT_COUNT];",
+		"return stmt_cache_acquire(db_reader(), &Todo_read_stmts[which], Todo_stmt_sql[which]);",
+		"sqlite3 *conn = db_write_begin();",
+		"MHD_OPTION_THREAD_POOL_SIZE, threads,",
+		"db_close();",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Only the INSERTs and the DELETEs go to the writer
+	writes := regexp.MustCompile(`Todo_stmt_writes\[Todo_STMT_COUNT\] = \{([^}]*)\}`).FindStringSubmatch(code)
+	if writes == nil {
+		t.Fatal("Generated code missing Todo_stmt_writes")
+	}
+	if got := strings.Join(strings.Fields(writes[1]), ""); !strings.HasPrefix(got, "1,0,0,0,0,1,1,1,") || strings.Count(got, "1") != 4 {
+		t.Errorf("Todo_stmt_writes = %s, want 1 for CREATE, DELETE, DELETE_MANY and IMPORT only", got)
+	}
+
+	// Without WAL, reads share the writer
+	if code := generate(t, todoStruct()); !strings.Contains(code, "#define DB_READ_POOL 0") {
+		t.Error("Read pool should be off without journal: wal")
+	}
+}
+
+func TestGroupCommitQueuesCreates(t *testing.T) {
+	s := todoStruct()
+	s.Decorators[0].KVArgs = map[string]string{"journal": "wal", "group_commit": "128", "group_commit_ms": "5"}
+	code := generate(t, s, &ast.PageDecl{Name: "TodoApp"})
+
+	expectedPatterns := []string{
+		"#define WRITE_BATCH_ROWS 128",
+		"#define WRITE_BATCH_MS 5",
+		"WriteJob *prev = atomic_exchange_explicit(&write_head, job, memory_order_acq_rel);",
+		"int Todo_create_async(char* title, int completed, WriteDone *done)",
+		"if (Todo_create_async(title, completed, &done)) {",
+		"write_done_wait(&done);",
+		"if (!write_behind_start()) {",
+		"write_behind_stop();",
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Off by default
+	if code := generate(t, todoStruct()); strings.Contains(code, "create_async") {
+		t.Error("Group commit should only be generated with @storage(group_commit: ...)")
+	}
+
+	// It needs WAL
+	s.Decorators[0].KVArgs = map[string]string{"group_commit": "128"}
+	gen, err := NewTemplateGenerator()
+	if err != nil {
+		t.Fatalf("Failed to create template generator: %v", err)
+	}
+	if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s}}); err == nil {
+		t.Error("Expected an error for group_commit without journal: wal")
+	}
+}
+
+func TestAggregatesAndStatsArePushedDown(t *testing.T) {
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "priority", Type: "int"})
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{
+			&ast.StatDecl{Properties: map[string]interface{}{"value": "Todo.count(where completed)", "label": "Done"}},
+			&ast.StatDecl{Properties: map[string]interface{}{"value": `Todo.sum(priority where !completed&&title!="x")`}},
+			&ast.StatDecl{Properties: map[string]interface{}{"value": `Todo.count(where title != "x%d")`}},
+		},
+	}
+	code := generate(t, s, page)
+
+	expectedPatterns := []string{
+		`"SELECT COUNT(*) FROM todos",`,
+		"int64_t Todo_count(void)",
+		"int64_t Todo_sum_priority(void)",
+		"int Todo_min_priority(int64_t* out)",
+		"int Todo_max_priority(int64_t* out)",
+		"int Todo_avg_priority(double* out)",
+		`"SELECT COUNT(*) FROM todos WHERE completed != 0",`,
+		`"SELECT COALESCE(SUM(priority), 0) FROM todos WHERE NOT completed != 0 AND title != ?",`,
+		`sqlite3_bind_text(stmt, 1, "x", -1, SQLITE_STATIC);`,
+		"if (!Todo_stat_1(value, sizeof(value))) {",
+		"<h6 class='card-subtitle text-muted'>%s</h6>",
+		`"Done", value);`,
+		// A label defaults to its source, escaped as HTML inside a C string
+		// passed as an argument, so a % in it is not a conversion
+		`"Todo.count(where title != &#34;x%d&#34;)", value);`,
+		`sqlite3_bind_text(stmt, 1, "x%d", -1, SQLITE_STATIC);`,
+	}
+
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "Todo_sum_completed") || strings.Contains(code, "Todo_sum_title") {
+		t.Error("Only numeric fields get sum/min/max/avg")
+	}
+
+	// Stat sources are checked against the struct
+	for _, bad := range []string{"Todo.count(where done)", "Todo.sum(title)", "Todo.count(where priority)", `Todo.count(where priority == "high")`, "Task.count()"} {
+		page := &ast.PageDecl{Name: "TodoApp", Body: []ast.Node{&ast.StatDecl{Properties: map[string]interface{}{"value": bad}}}}
+		gen, err := NewTemplateGenerator()
+		if err != nil {
+			t.Fatalf("Failed to create template generator: %v", err)
+		}
+		if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s, page}}); err == nil {
+			t.Errorf("Expected an error for Stat %s", bad)
+		}
+	}
+}
+
+func TestDataListSourceCompilesToQuery(t *testing.T) {
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "priority", Type: "int"})
+	list := &ast.DataListDecl{Properties: map[string]interface{}{
+		"source":  `Todo.where(completed == false && priority >= 2).order(priority desc, title).limit(50)`,
+		"columns": []string{"title", "priority"},
+	}}
+	page := &ast.PageDecl{Name: "TodoApp", Body: []ast.Node{list}}
+	code := generate(t, s, page)
+
+	expectedPatterns := []string{
+		`"SELECT id, title, priority FROM todos WHERE completed = ? AND priority >= ? ORDER BY priority DESC, title LIMIT 50"`,
+		"sqlite3_bind_int(stmt, 1, 0);",
+		"sqlite3_bind_int64(stmt, 2, 2LL);",
+		"int streaming = Todo_list_cursor_open(&cur);",
+		"while (streaming && (row = Todo_cursor_next_view(&cur)) != NULL) {",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// A filtered, paged list binds the filter ahead of the page bounds
+	list.Properties["source"] = "Todo.where(priority >= 2)"
+	list.Properties["pageSize"] = "20"
+	code = generate(t, s, page)
+	for _, pattern := range []string{
+		`"SELECT id, title, priority FROM todos WHERE (priority >= ?) AND id > ? ORDER BY id LIMIT ?"`,
+		"sqlite3_bind_int64(stmt, 2, after_id);",
+		"sqlite3_bind_int(stmt, 3, limit);",
+	} {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Unknown fields, repeated or unknown methods, and ordered pages are rejected
+	for _, source := range []string{
+		"Todo.where(due == 1)",
+		"Todo.order(title).order(id)",
+		"Todo.sort(title)",
+		"Todo.order(title desc)",
+	} {
+		list.Properties["source"] = source
+		gen, err := NewTemplateGenerator()
+		if err != nil {
+			t.Fatalf("Failed to create template generator: %v", err)
+		}
+		if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s, page}}); err == nil {
+			t.Errorf("Expected an error for DataList source %s", source)
+		}
+	}
+
+	// So is a page size that is not a positive count
+	list.Properties["source"] = "Todo.where(priority >= 2)"
+	for _, size := range []string{"0", "-5", "twenty"} {
+		list.Properties["pageSize"] = size
+		gen, err := NewTemplateGenerator()
+		if err != nil {
+			t.Fatalf("Failed to create template generator: %v", err)
+		}
+		if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s, page}}); err == nil {
+			t.Errorf("Expected an error for DataList pageSize %s", size)
+		}
+	}
+}
+
+func TestDeleteManyBindsIdArray(t *testing.T) {
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{&ast.DataListDecl{Properties: map[string]interface{}{}}},
+	}
+	code := generate(t, todoStruct(), page)
+
+	expectedPatterns := []string{
+		`"DELETE FROM todos WHERE id IN (SELECT value FROM json_each(?))"`,
+		"int64_t Todo_delete_many(const int64_t* ids, size_t n) {",
+		"sqlite3_bind_text(stmt, 1, json, (int)(p - json), SQLITE_STATIC);",
+		`"BEGIN IMMEDIATE" : "SAVEPOINT Todo_delete_many"`,
+		"<form method='post' action='/todos/delete_many'>",
+		"<input type='checkbox' name='id' value='%lld'>",
+		`if (strcmp(url, "/todos/delete_many") == 0 && strcmp(method, "POST") == 0) {`,
+		"Todo_delete_many(ids, n);",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// The bulk route must be matched before the single delete's prefix match
+	if strings.Index(code, `"/todos/delete_many") == 0`) > strings.Index(code, `strstr(url, "/todos/delete")`) {
+		t.Error("Bulk delete route should be handled before /todos/delete")
+	}
+}
+
+func TestUpsertOnUniqueKeys(t *testing.T) {
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "slug", Type: "string", Decorators: []*ast.Decorator{{Name: "unique"}}})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		`"INSERT INTO todos (title, completed, slug) VALUES (?, ?, ?) ON CONFLICT(slug) DO UPDATE SET title = excluded.title, completed = excluded.completed, slug = excluded.slug RETURNING rowid"`,
+		"int64_t Todo_upsert(char* title, int completed, char* slug) {",
+		"int Todo_upsert_many(const Todo* rows, size_t n, int64_t* ids) {",
+		"ids[done] = sqlite3_column_int64(stmt, 0);",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Without a unique key there is nothing to conflict on
+	if code := generate(t, todoStruct()); strings.Contains(code, "Todo_upsert") {
+		t.Error("Upsert should only be generated for structs with unique keys")
+	}
+}
+
+func TestRowViewsBorrowColumnBuffers(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"typedef struct TodoView {",
+		"const char* title;",
+		"size_t title_len;",
+		"view->title = (const char*)sqlite3_column_text(stmt, 1);",
+		"view->title_len = (size_t)sqlite3_column_bytes(stmt, 1);",
+		"Todo* Todo_view_to_owned(const TodoView* view) {",
+		"const TodoView* Todo_cursor_next_view(Todo_cursor *cur) {",
+		"int Todo_each_view(int (*callback)(const TodoView* row, void* ctx), void* ctx) {",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Reading a view copies nothing
+	start := strings.Index(code, "static void Todo_read_view(")
+	end := strings.Index(code, "static size_t Todo_view_size(")
+	if start < 0 || end < start {
+		t.Fatal("Generated code missing Todo_read_view")
+	}
+	if body := code[start:end]; strings.Contains(body, "malloc") || strings.Contains(body, "copy") {
+		t.Error("Todo_read_view should not allocate or copy")
+	}
+}
+
+func TestBoundedStringsAreInline(t *testing.T) {
+	s := todoStruct()
+	s.Fields[1].Decorators = append(s.Fields[1].Decorators, &ast.Decorator{Name: "length", KVArgs: map[string]string{"max": "200"}})
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "body", Type: "string", Decorators: []*ast.Decorator{
+		{Name: "length", KVArgs: map[string]string{"max": "1000"}},
+	}})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		"char title[201]; // @length(max: 200), stored inline",
+		"uint8_t title_len;",
+		"char* body;",
+		"if (!Todo_fits_title(title)) {",
+		"obj->title_len = (uint8_t)inline_copy_text(obj->title, 200, title_text, title_len);",
+		"int Todo_set_title(Todo* obj, const char* value) {",
+		"if (!Todo_row_fits(&rows[i])) {",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Raising the threshold brings the longer field inline too
+	s.Decorators[0].KVArgs = map[string]string{"inline_strings": "1000"}
+	code = generate(t, s)
+	if !strings.Contains(code, "char body[1001]; // @length(max: 1000), stored inline") || !strings.Contains(code, "uint16_t body_len;") {
+		t.Error("inline_strings: 1000 should store body inline with a 16-bit length")
+	}
+}
+
+func TestRowCacheFrontsFind(t *testing.T) {
+	s := todoStruct()
+	s.Decorators = append(s.Decorators, &ast.Decorator{Name: "cache", KVArgs: map[string]string{"rows": "100000"}})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		"#define Todo_CACHE_SHARDS 16",
+		"#define Todo_CACHE_SHARD_ROWS 6250",
+		"#define Todo_CACHE_BUCKETS 8192",
+		"const Todo* Todo_find(int64_t id) {",
+		"Todo* Todo_load(int64_t id) {",
+		"void Todo_free(const Todo* obj) {",
+		"void Todo_cache_stats(uint64_t* hits, uint64_t* misses) {",
+		"Todo_cache_forget(obj->id);",
+		"Todo_cache_forget(id);",
+		"Todo_cache_forget(ids[done + i]);",
+		"Todo_cache_clear();",
+		"Todo_cache_init();",
+		// Rows are kept only while no write to todos is open or has ended
+		// since they were read, and dropped when another process writes
+		"|| atomic_load(&Todo_table.writes_open) != 0",
+		"|| db_table_version(&Todo_table) != version",
+		"Todo_cache_flush();",
+		`sqlite3_exec(db, "PRAGMA data_version", db_read_data_version, &version, NULL);`,
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// A write marks its table open before its statement runs
+	start := strings.Index(code, "int Todo_delete(int64_t id) {")
+	if touch := strings.Index(code[start:], "Todo_touch();"); start < 0 || touch < 0 || touch > strings.Index(code[start:], "sqlite3_step(") {
+		t.Error("Todo_delete should touch todos before deleting")
+	}
+
+	// Without @cache, find reads straight through
+	code = generate(t, todoStruct())
+	if strings.Contains(code, "Todo_cache_") || !strings.Contains(code, "Todo* Todo_find(int64_t id) {") {
+		t.Error("Only @cache structs should get a row cache")
+	}
+	if strings.Contains(code, "db_check_external") {
+		t.Error("Without @cache, nothing polls for other processes' writes")
+	}
+}
+
+func TestSnapshotCacheForAll(t *testing.T) {
+	s := todoStruct()
+	s.Decorators = append(s.Decorators, &ast.Decorator{Name: "cache", KVArgs: map[string]string{"snapshot": "true"}})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		"static DbTable Todo_table;",
+		"} TodoSnapshot;",
+		"const TodoSnapshot* Todo_snapshot(void) {",
+		"void Todo_snapshot_release(const TodoSnapshot* snapshot) {",
+		"snapshot->rows = Todo_all(&snapshot->count);",
+		"Todo_snapshot_clear();",
+		"Todo_touch();",
+		// One caller rebuilds while the others wait for its snapshot
+		"pthread_cond_wait(&Todo_snapshot_built, &Todo_snapshot_lock);",
+		// A hit takes its reference without the lock
+		"static _Atomic(TodoSnapshot*) Todo_snapshot_current = NULL;",
+		"TodoSnapshot *current = atomic_load(&Todo_snapshot_current);",
+		"old = Todo_snapshot_swap(snapshot);",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+	if strings.Contains(code, "Todo_cache_get") {
+		t.Error("snapshot: true alone should not add a row cache")
+	}
+	start := strings.Index(code, "const TodoSnapshot* Todo_snapshot(void) {")
+	if hit := strings.Index(code[start:], "return current;"); start < 0 || hit < 0 || hit > strings.Index(code[start:], "pthread_mutex_lock(") {
+		t.Error("A snapshot hit should return before taking the lock")
+	}
+
+	// Unknown settings are rejected
+	s = todoStruct()
+	s.Decorators = append(s.Decorators, &ast.Decorator{Name: "cache", KVArgs: map[string]string{"table": "true"}})
+	gen, _ := NewTemplateGenerator()
+	if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s}}); err == nil {
+		t.Error("Expected an error for an unknown @cache setting")
+	}
+}
+
+func TestBulkImportCommand(t *testing.T) {
+	s := todoStruct()
+	s.Fields[1].Decorators = append(s.Fields[1].Decorators, &ast.Decorator{Name: "index"})
+	code := generate(t, s)
+
+	expectedPatterns := []string{
+		`"INSERT INTO todos (id, title, completed) VALUES (?, ?, ?)",`,
+		"int64_t Todo_import_csv(const char* path) {",
+		"int64_t Todo_import_jsonl(const char* path) {",
+		"mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)",
+		"sqlite3_bind_text64(stmt, 2, values[1].p, values[1].len, SQLITE_STATIC, SQLITE_UTF8);",
+		`import_exec(run->conn, "DROP INDEX IF EXISTS idx_todos_title");`,
+		`import_exec(run->conn, "CREATE INDEX IF NOT EXISTS idx_todos_title ON todos (title)");`,
+		"if (strcmp(argv[2], \"Todo\") == 0) {",
+		"int status = app_command(argc, argv);",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Programs without pages get a main too, for the command line
+	if !strings.Contains(code, "int main(int argc, char *argv[]) {") {
+		t.Error("Expected a main for a program without pages")
+	}
+
+	// Float parsing is only emitted for float columns
+	if strings.Contains(code, "import_double(") {
+		t.Error("import_double should not be emitted without a float field")
+	}
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "estimate", Type: "float"})
+	if code := generate(t, s); !strings.Contains(code, "if (!import_double(&values[3], &v)) {") {
+		t.Error("Expected import_double for a float field")
+	}
+}
+
+func TestBulkExportCommand(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		`"SELECT id, title, completed FROM todos",`,
+		"int64_t Todo_export(int fd, int format) {",
+		"Todo_stmt(Todo_STMT_EXPORT)",
+		`export_literal(&w, "id,title,completed\n");`,
+		`export_literal(w, "{\"id\":");`,
+		`export_literal(w, ",\"completed\":");`,
+		`export_literal(w, "true");`,
+		"export_csv_text(w, text, (size_t)sqlite3_column_bytes(stmt, 1));",
+		"export_rows = Todo_export;",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// The struct is resolved before --output is truncated
+	if check, open := strings.Index(code, "if (export_rows == NULL) {"), strings.Index(code, "O_TRUNC"); check < 0 || open < check {
+		t.Error("app_export should reject an unknown struct before opening --output")
+	}
+
+	// Rows are written to one buffer, not allocated one by one
+	start := strings.Index(code, "static void Todo_export_csv_row(")
+	end := strings.Index(code, "int64_t Todo_export(int fd, int format) {")
+	if start < 0 || end < start || strings.Contains(code[start:end], "alloc(") {
+		t.Error("Export rows should not allocate")
+	}
+
+	// Float formatting is only emitted for float columns
+	if strings.Contains(code, "export_double(") {
+		t.Error("export_double should not be emitted without a float field")
+	}
+	s := todoStruct()
+	s.Fields = append(s.Fields, &ast.FieldDecl{Name: "estimate", Type: "float"})
+	if code := generate(t, s); !strings.Contains(code, `export_double(w, sqlite3_column_double(stmt, 3), "null");`) {
+		t.Error("Expected export_double for a float field")
+	}
+}
+
+func TestInitTableMigratesExistingTable(t *testing.T) {
+	code := generate(t, todoStruct())
+
+	expectedPatterns := []string{
+		"static const MigrateColumn Todo_columns[] = {",
+		`{ "title", "TEXT", "''", 1, 0, 0 },`,
+		`{ "completed", "INTEGER", "0", 0, 0, 0 },`,
+		"static const MigrateTable Todo_migration = {",
+		"if (!migrate_table(&Todo_migration)) {",
+		"int Todo_init_table() {",
+		"if (!Todo_init_table()) {",
+		// Only ./app migrate rebuilds, so the old server can keep serving
+		`migrate_rebuilds = argc == 2 && strcmp(argv[1], "migrate") == 0;`,
+		"if (rebuild && !migrate_rebuilds) {",
+		"PRAGMA table_info(%s)",
+		"CREATE TRIGGER %s__migrate_update AFTER UPDATE ON %s BEGIN ",
+		`"SELECT id, title, completed FROM todos WHERE id = ?",`,
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// Reads name their columns, so columns kept from an older schema are
+	// never read into the struct
+	if strings.Contains(code, "SELECT * FROM todos") {
+		t.Error("Reads should name their columns")
+	}
+}
+
+func TestStructReferenceJoinsIncludedRows(t *testing.T) {
+	todo := todoStruct()
+	todo.Fields = append(todo.Fields, &ast.FieldDecl{Name: "owner", Type: "User"})
+	user := &ast.StructDecl{
+		Name: "User",
+		Fields: []*ast.FieldDecl{
+			{Name: "id", Type: "int", Decorators: []*ast.Decorator{{Name: "primary"}, {Name: "autoincrement"}}},
+			{Name: "name", Type: "string"},
+		},
+	}
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{
+			&ast.DataListDecl{Properties: map[string]interface{}{
+				"source":   "Todo.all()",
+				"include":  []string{"owner"},
+				"columns":  []string{"title", "owner.name"},
+				"pageSize": "20",
+			}},
+		},
+	}
+	code := generate(t, todo, user, page)
+
+	expectedPatterns := []string{
+		`"owner_id INTEGER REFERENCES users(id)"`,
+		"int64_t owner_id;",
+		"struct User *owner; // Joined in with Todo_INCLUDE_OWNER, else NULL",
+		"Todo* Todo_create(char* title, int completed, int64_t owner_id)",
+		"Todo_INCLUDE_OWNER = 1u << 0,",
+		`len += sprintf(sql + len, ", r0.id, r0.name");`,
+		`len += sprintf(sql + len, " LEFT JOIN users r0 ON r0.id = t.owner_id");`,
+		"obj->owner = User_read_columns(stmt, column, &arena);",
+		"Todo** Todo_all_including(unsigned include, int* count)",
+		"items = Todo_page_including(Todo_INCLUDE_OWNER, after_arg != NULL ? atoll(after_arg) : INT64_MIN, 20 + 1, &count);",
+		`offset += html_escape(html + offset, row->owner->name, SIZE_MAX);`,
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	// The declared AST is left as it was
+	if todo.Fields[3].Name != "owner" || todo.Fields[3].Type != "User" {
+		t.Error("Lowering references should not modify the declared struct")
+	}
+}
+
+func TestSearchableFieldsUseFTS5(t *testing.T) {
+	s := todoStruct()
+	s.Fields[1].Decorators = append(s.Fields[1].Decorators, &ast.Decorator{Name: "searchable"})
+	page := &ast.PageDecl{
+		Name: "TodoApp",
+		Body: []ast.Node{
+			&ast.DataListDecl{Properties: map[string]interface{}{
+				"source": "Todo.all()",
+				"search": "true",
+			}},
+		},
+	}
+	code := generate(t, s, page)
+
+	expectedPatterns := []string{
+		`"CREATE VIRTUAL TABLE todos_fts USING fts5(title, content='todos', content_rowid='id')";`,
+		`"CREATE TRIGGER IF NOT EXISTS todos_fts_update AFTER UPDATE OF id, title ON todos BEGIN "`,
+		"INSERT INTO todos_fts (todos_fts) VALUES ('rebuild');",
+		"Todo_search_init(conn);",
+		`"SELECT t.id, t.title, t.completed, todos_fts.rank, snippet(todos_fts, -1, char(1), char(2), '...', 12) FROM todos_fts JOIN todos t ON t.id = todos_fts.rowid WHERE todos_fts MATCH ? ORDER BY todos_fts.rank LIMIT ? OFFSET ?",`,
+		"TodoSearchHit** Todo_search(const char* query, int limit, int64_t* cursor, int* count) {",
+		"hits = Todo_search(search_arg, 20, &cursor, &hit_count);",
+		"offset += html_escape(html + offset, search_arg, 200);",
+		"hit->snippet = arena_copy_snippet(&arena, snippet, (size_t)sqlite3_column_bytes(stmt, 4));",
+		`case '\1': return "<mark>";`,
+		`case '<': return "&lt;";`,
+		// Stored text is escaped, and the page grows to fit each row
+		"offset += html_escape(html + offset, row->title, SIZE_MAX);",
+		"html = html_reserve(html, &capacity, offset, html_escaped_size(row->title));",
+		"html = html_reserve(html, &capacity, offset, strlen(snippet));",
+	}
+	for _, pattern := range expectedPatterns {
+		if !strings.Contains(code, pattern) {
+			t.Errorf("Generated code missing expected pattern: %s", pattern)
+		}
+	}
+
+	if strings.Contains(code, `"<td>%s</td>", row->title`) {
+		t.Error("Text cells should not be written unescaped")
+	}
+
+	// Only string fields can be searched
+	s = todoStruct()
+	s.Fields[2].Decorators = append(s.Fields[2].Decorators, &ast.Decorator{Name: "searchable"})
+	gen, _ := NewTemplateGenerator()
+	if _, err := gen.Generate(&ast.Program{Statements: []ast.Node{s}}); err == nil {
+		t.Error("Expected an error for @searchable on a bool field")
+	}
+}
+
 func min(a, b int) int {
 	if a < b {
 		return a
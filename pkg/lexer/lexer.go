@@ -142,6 +142,9 @@ func (l *Lexer) NextToken() Token {
 	case ',':
 		tok.Type = COMMA
 		tok.Literal = string(l.ch)
+	case '.':
+		tok.Type = DOT
+		tok.Literal = string(l.ch)
 	case ';':
 		tok.Type = SEMICOLON
 		tok.Literal = string(l.ch)
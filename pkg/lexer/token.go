@@ -59,6 +59,7 @@ const (
 
 	// Delimiters
 	COMMA     TokenType = ","
+	DOT       TokenType = "."
 	SEMICOLON TokenType = ";"
 	COLON     TokenType = ":"
 	LPAREN    TokenType = "("
@@ -2,6 +2,9 @@ package parser
 
 import (
 	"fmt"
+	"strings"
+	"unicode"
+
 	"github.com/gunesh/zelang/pkg/ast"
 	"github.com/gunesh/zelang/pkg/lexer"
 )
@@ -132,9 +135,10 @@ func (p *Parser) parseDecorators() []*ast.Decorator {
 		}
 
 		decorator := &ast.Decorator{
-			Name:   p.curToken.Literal,
-			Args:   []string{},
-			KVArgs: make(map[string]string),
+			Name:     p.curToken.Literal,
+			Args:     []string{},
+			KVArgs:   make(map[string]string),
+			ListArgs: make(map[string][]string),
 		}
 
 		p.nextToken()
@@ -152,8 +156,17 @@ func (p *Parser) parseDecorators() []*ast.Decorator {
 					// Check if this is a key: value pair
 					if p.curTokenIs(lexer.COLON) {
 						p.nextToken() // skip :
-						value := p.curToken.Literal
-						decorator.KVArgs[arg] = value
+						if p.curTokenIs(lexer.LBRACKET) {
+							decorator.ListArgs[arg] = p.parseListValue()
+						} else {
+							value := p.curToken.Literal
+							// A size such as 256MB lexes as INT then IDENT
+							if p.curTokenIs(lexer.INT) && p.peekTokenIs(lexer.IDENT) {
+								p.nextToken()
+								value += p.curToken.Literal
+							}
+							decorator.KVArgs[arg] = value
+						}
 						p.nextToken()
 					} else {
 						decorator.Args = append(decorator.Args, arg)
@@ -277,13 +290,155 @@ func (p *Parser) parsePageDecl() *ast.PageDecl {
 
 	// Parse page properties and body
 	for !p.curTokenIs(lexer.RBRACE) && !p.curTokenIs(lexer.EOF) {
-		// For now, just skip to the end
+		switch {
+		case p.curTokenIs(lexer.DATALIST):
+			if !p.expectPeek(lexer.LBRACE) {
+				return nil
+			}
+			pageDecl.Body = append(pageDecl.Body, &ast.DataListDecl{Properties: p.parseMapValue()})
+		case p.curTokenIs(lexer.FORM):
+			if !p.expectPeek(lexer.LBRACE) {
+				return nil
+			}
+			form := &ast.FormDecl{Properties: make(map[string]string), Body: []ast.Node{}}
+			for key, value := range p.parseMapValue() {
+				if str, ok := value.(string); ok {
+					form.Properties[key] = str
+				}
+			}
+			pageDecl.Body = append(pageDecl.Body, form)
+		case p.curTokenIs(lexer.IDENT) && p.curToken.Literal == "Stat" && p.peekTokenIs(lexer.LBRACE):
+			p.nextToken() // move to {
+			pageDecl.Body = append(pageDecl.Body, &ast.StatDecl{Properties: p.parseMapValue()})
+		case p.curTokenIs(lexer.IDENT) && p.peekTokenIs(lexer.COLON):
+			key := p.curToken.Literal
+			p.nextToken() // skip key
+			p.nextToken() // skip :
+			if str, ok := p.parsePropertyValue().(string); ok {
+				pageDecl.Properties[key] = str
+			}
+		case p.curTokenIs(lexer.LBRACE):
+			// Components we don't model yet
+			p.skipBlock()
+		}
 		p.nextToken()
 	}
 
 	return pageDecl
 }
 
+// parsePropertyValue parses the value of a `key: value` property, starting at
+// its first token and stopping on its last one. Lists become []string, nested
+// blocks become map[string]interface{}, and everything else (literals and
+// expressions such as Todo.all()) becomes a string.
+func (p *Parser) parsePropertyValue() interface{} {
+	switch p.curToken.Type {
+	case lexer.LBRACKET:
+		return p.parseListValue()
+	case lexer.LBRACE:
+		return p.parseMapValue()
+	}
+
+	tokens := []lexer.Token{}
+	depth := 0
+	for !p.curTokenIs(lexer.EOF) {
+		tokens = append(tokens, p.curToken)
+
+		switch p.curToken.Type {
+		case lexer.LPAREN, lexer.LBRACKET, lexer.LBRACE:
+			depth++
+		case lexer.RPAREN, lexer.RBRACKET, lexer.RBRACE:
+			depth--
+		}
+
+		if depth <= 0 && (p.peekTokenIs(lexer.SEMICOLON) || p.peekTokenIs(lexer.COMMA) ||
+			p.peekTokenIs(lexer.RBRACE) || p.peekTokenIs(lexer.RBRACKET) || p.peekTokenIs(lexer.EOF)) {
+			break
+		}
+		p.nextToken()
+	}
+
+	if len(tokens) == 1 {
+		return tokens[0].Literal
+	}
+	return joinTokens(tokens)
+}
+
+// parseListValue parses [a, b, ...] starting at '[' and stopping on ']'
+func (p *Parser) parseListValue() []string {
+	items := []string{}
+
+	p.nextToken() // skip [
+	for !p.curTokenIs(lexer.RBRACKET) && !p.curTokenIs(lexer.EOF) {
+		if !p.curTokenIs(lexer.COMMA) {
+			if str, ok := p.parsePropertyValue().(string); ok {
+				items = append(items, str)
+			}
+		}
+		p.nextToken()
+	}
+
+	return items
+}
+
+// parseMapValue parses { key: value; ... } starting at '{' and stopping on
+// '}'. Entries may be separated by ';' or ','.
+func (p *Parser) parseMapValue() map[string]interface{} {
+	properties := make(map[string]interface{})
+
+	p.nextToken() // skip {
+	for !p.curTokenIs(lexer.RBRACE) && !p.curTokenIs(lexer.EOF) {
+		if p.peekTokenIs(lexer.COLON) {
+			key := p.curToken.Literal
+			p.nextToken() // skip key
+			p.nextToken() // skip :
+			properties[key] = p.parsePropertyValue()
+		} else if p.curTokenIs(lexer.LBRACE) {
+			p.skipBlock()
+		}
+		p.nextToken()
+	}
+
+	return properties
+}
+
+// skipBlock skips a balanced { ... } block, stopping on its closing brace
+func (p *Parser) skipBlock() {
+	braceCount := 0
+	for !p.curTokenIs(lexer.EOF) {
+		if p.curTokenIs(lexer.LBRACE) {
+			braceCount++
+		} else if p.curTokenIs(lexer.RBRACE) {
+			braceCount--
+			if braceCount == 0 {
+				return
+			}
+		}
+		p.nextToken()
+	}
+}
+
+// joinTokens turns an expression back into source text, keeping a space only
+// between adjacent words (so "id desc" survives but "Todo.all()" stays tight)
+func joinTokens(tokens []lexer.Token) string {
+	var out strings.Builder
+	prevWord := false
+	for _, tok := range tokens {
+		literal := tok.Literal
+		isWord := tok.Type != lexer.STRING && len(literal) > 0 &&
+			(literal[0] == '_' || unicode.IsLetter(rune(literal[0])) || unicode.IsDigit(rune(literal[0])))
+		if tok.Type == lexer.STRING {
+			literal = `"` + literal + `"`
+		}
+		if prevWord && isWord {
+			out.WriteString(" ")
+		}
+		out.WriteString(literal)
+		prevWord = isWord
+	}
+	return out.String()
+}
+
 func (p *Parser) parseFunctionDecl() *ast.FunctionDecl {
 	funcDecl := &ast.FunctionDecl{}
 
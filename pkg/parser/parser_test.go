@@ -0,0 +1,133 @@
+package parser
+
+import (
+	"reflect"
+	"testing"
+
+	"github.com/gunesh/zelang/pkg/ast"
+	"github.com/gunesh/zelang/pkg/lexer"
+)
+
+func TestParsePageBody(t *testing.T) {
+	input := `
+@route("/")
+Page TodoApp {
+    title: "Todo Manager";
+
+    DataList {
+        source: Todo.all();
+        columns: ["id", "title", "completed"];
+        pageSize: 20;
+    }
+
+    Form {
+        action: "/todos/create";
+        fields: {
+            title: { type: "text", required: true }
+        };
+        submit: "Add Todo";
+    }
+
+    Stat { value: Todo.count(where completed); label: "Done"; }
+}
+`
+	p := New(lexer.New(input))
+	program := p.ParseProgram()
+	if len(p.Errors()) > 0 {
+		t.Fatalf("Parser errors: %v", p.Errors())
+	}
+	if len(program.Statements) != 1 {
+		t.Fatalf("Expected 1 statement, got %d", len(program.Statements))
+	}
+
+	page, ok := program.Statements[0].(*ast.PageDecl)
+	if !ok {
+		t.Fatalf("Expected *ast.PageDecl, got %T", program.Statements[0])
+	}
+	if page.Properties["title"] != "Todo Manager" {
+		t.Errorf("Expected title %q, got %q", "Todo Manager", page.Properties["title"])
+	}
+	if len(page.Body) != 3 {
+		t.Fatalf("Expected 3 components, got %d", len(page.Body))
+	}
+
+	dataList, ok := page.Body[0].(*ast.DataListDecl)
+	if !ok {
+		t.Fatalf("Expected *ast.DataListDecl, got %T", page.Body[0])
+	}
+	expected := map[string]interface{}{
+		"source":   "Todo.all()",
+		"columns":  []string{"id", "title", "completed"},
+		"pageSize": "20",
+	}
+	if !reflect.DeepEqual(dataList.Properties, expected) {
+		t.Errorf("DataList properties = %#v, want %#v", dataList.Properties, expected)
+	}
+
+	form, ok := page.Body[1].(*ast.FormDecl)
+	if !ok {
+		t.Fatalf("Expected *ast.FormDecl, got %T", page.Body[1])
+	}
+	if form.Properties["action"] != "/todos/create" || form.Properties["submit"] != "Add Todo" {
+		t.Errorf("Unexpected form properties: %#v", form.Properties)
+	}
+
+	stat, ok := page.Body[2].(*ast.StatDecl)
+	if !ok {
+		t.Fatalf("Expected *ast.StatDecl, got %T", page.Body[2])
+	}
+	if stat.Properties["value"] != "Todo.count(where completed)" || stat.Properties["label"] != "Done" {
+		t.Errorf("Unexpected stat properties: %#v", stat.Properties)
+	}
+}
+
+func TestParseDecoratorListArgs(t *testing.T) {
+	input := `
+@index(fields: [owner_id, created_at])
+struct Todo {
+    int owner_id;
+    string created_at;
+}
+`
+	p := New(lexer.New(input))
+	program := p.ParseProgram()
+	if len(p.Errors()) > 0 {
+		t.Fatalf("Parser errors: %v", p.Errors())
+	}
+
+	s, ok := program.Statements[0].(*ast.StructDecl)
+	if !ok {
+		t.Fatalf("Expected *ast.StructDecl, got %T", program.Statements[0])
+	}
+	if len(s.Fields) != 2 {
+		t.Errorf("Expected 2 fields, got %d", len(s.Fields))
+	}
+
+	dec := s.Decorators[0]
+	if got := dec.ListArgs["fields"]; !reflect.DeepEqual(got, []string{"owner_id", "created_at"}) {
+		t.Errorf("fields = %#v, want [owner_id created_at]", got)
+	}
+}
+
+func TestParseStorageTuningArgs(t *testing.T) {
+	input := `
+@storage(sqlite, journal: wal, mmap: 256MB, busy_timeout: 5000, path: "data/app.db")
+struct Todo {
+    int id;
+}
+`
+	p := New(lexer.New(input))
+	program := p.ParseProgram()
+	if len(p.Errors()) > 0 {
+		t.Fatalf("Parser errors: %v", p.Errors())
+	}
+
+	dec := program.Statements[0].(*ast.StructDecl).Decorators[0]
+	if !reflect.DeepEqual(dec.Args, []string{"sqlite"}) {
+		t.Errorf("args = %#v, want [sqlite]", dec.Args)
+	}
+	want := map[string]string{"journal": "wal", "mmap": "256MB", "busy_timeout": "5000", "path": "data/app.db"}
+	if !reflect.DeepEqual(dec.KVArgs, want) {
+		t.Errorf("kv args = %#v, want %#v", dec.KVArgs, want)
+	}
+}